@@ -0,0 +1,124 @@
+#include "baseline.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	typedef nlohmann::json _json;
+
+	double getSeconds(Clock::duration duration)
+	{
+		return std::chrono::duration<double>(duration).count();
+	}
+
+	bool getNumber(const _json &j, const char *name, double &value)
+	{
+		auto it = j.find(name);
+		if (it == j.end() || !it->is_number())
+			return false;
+		value = it->get<double>();
+		return true;
+	}
+}
+
+Clock::duration Measure::getPercentile(uint32_t percent) const
+{
+	if (durations.empty())
+		return Clock::duration::zero();
+
+	size_t rank = (size_t)std::ceil(percent / 100.0 * durations.size());
+	return durations[std::max<size_t>(rank, 1) - 1];
+}
+
+Clock::duration Measure::getMedian() const
+{
+	return getPercentile(50);
+}
+
+ComparisonParameters::ComparisonParameters()
+	: tolerance(0.1f)
+{}
+
+_json dumpMeasures(const std::vector<Measure> &measures, const _json &jParameters)
+{
+	_json jMeasures = _json::array();
+	for (auto &measure : measures)
+	{
+		double median = getSeconds(measure.getMedian());
+
+		_json jMeasure = _json::object();
+		jMeasure["name"] = measure.name;
+		jMeasure["guarded"] = measure.guarded;
+		jMeasure["repetitions"] = measure.durations.size();
+		jMeasure["median"] = median;
+		jMeasure["p95"] = getSeconds(measure.getPercentile(95));
+		jMeasure["symbols"] = measure.symbolCount;
+		jMeasure["symbolsPerSecond"] = median > 0.0 ? measure.symbolCount / median : 0.0;
+		if (measure.byteCount)
+		{
+			jMeasure["bytes"] = measure.byteCount;
+			jMeasure["bytesPerSecond"] = median > 0.0 ? measure.byteCount / median : 0.0;
+		}
+		jMeasure["allocations"] = measure.allocationCount;
+		jMeasure["allocatedBytes"] = measure.allocatedBytes;
+		jMeasure["peakMemory"] = measure.peakMemory;
+		jMeasures.push_back(jMeasure);
+	}
+
+	_json j = _json::object();
+	j["parameters"] = jParameters;
+	j["measures"] = jMeasures;
+	return j;
+}
+
+bool compareMeasures(const std::vector<Measure> &measures, const _json &jBaseline, _json &jComparisons, const ComparisonParameters &parameters)
+{
+	bool succeeded = true;
+	jComparisons = _json::array();
+
+	auto itBaselineMeasures = jBaseline.find("measures");
+	if (itBaselineMeasures == jBaseline.end() || !itBaselineMeasures->is_array())
+		return true;
+
+	for (auto &measure : measures)
+	{
+		auto itBaselineMeasure = std::find_if(itBaselineMeasures->begin(), itBaselineMeasures->end(), [&measure](const _json &jMeasure)
+		{
+			auto itName = jMeasure.find("name");
+			return itName != jMeasure.end() && itName->is_string() && itName->get<std::string>() == measure.name;
+		});
+		if (itBaselineMeasure == itBaselineMeasures->end())
+			continue;
+
+		double baselineMedian, baselineP95, baselineAllocations;
+		if (!getNumber(*itBaselineMeasure, "median", baselineMedian)
+			|| !getNumber(*itBaselineMeasure, "p95", baselineP95)
+			|| !getNumber(*itBaselineMeasure, "allocations", baselineAllocations))
+			continue;
+
+		double median = getSeconds(measure.getMedian());
+		double p95 = getSeconds(measure.getPercentile(95));
+
+		double threshold = baselineMedian * parameters.tolerance + (baselineP95 - baselineMedian) + (p95 - median);
+		bool slower = median - baselineMedian > threshold;
+		bool moreAllocations = measure.allocationCount > baselineAllocations * (1.0 + parameters.tolerance);
+
+		_json jComparison = _json::object();
+		jComparison["name"] = measure.name;
+		jComparison["guarded"] = measure.guarded;
+		jComparison["baselineMedian"] = baselineMedian;
+		jComparison["median"] = median;
+		jComparison["threshold"] = threshold;
+		jComparison["baselineAllocations"] = (uint64_t)baselineAllocations;
+		jComparison["allocations"] = measure.allocationCount;
+		jComparison["slower"] = slower;
+		jComparison["moreAllocations"] = moreAllocations;
+		jComparisons.push_back(jComparison);
+
+		if (measure.guarded && (slower || moreAllocations))
+			succeeded = false;
+	}
+
+	return succeeded;
+}
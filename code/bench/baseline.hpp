@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <json.hpp>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Measure
+{
+	std::string name;
+	bool guarded; // a regression makes the run fail
+	std::vector<Clock::duration> durations; // one per repetition, sorted
+	uint64_t symbolCount; // processed
+	uint64_t byteCount; // read or written, 0 if not relevant
+	uint64_t allocationCount; // in the last repetition
+	uint64_t allocatedBytes; // in the last repetition
+	uint64_t peakMemory; // of the process, after the measure
+
+	Clock::duration getPercentile(uint32_t percent) const; // nearest rank
+	Clock::duration getMedian() const;
+};
+
+struct ComparisonParameters
+{
+	ComparisonParameters();
+
+	// Slowdown always accepted, relative to the baseline median. On top of it, the spread between median and
+	// 95th percentile of both runs is accepted as noise. Allocation counts have no noise, only this tolerance.
+	float tolerance;
+};
+
+nlohmann::json dumpMeasures(const std::vector<Measure> &measures, const nlohmann::json &jParameters);
+
+// jComparisons receives one entry per measure found in the baseline
+// returns false if any guarded measure regressed
+bool compareMeasures(const std::vector<Measure> &measures, const nlohmann::json &jBaseline, nlohmann::json &jComparisons, const ComparisonParameters &parameters = ComparisonParameters());
@@ -0,0 +1,218 @@
+#include "generator.hpp"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	std::string getQualifiedName(const GeneratedProject::Symbol &symbol)
+	{
+		std::string name;
+		for (auto &ns : symbol.namespaces)
+			name += "::" + ns;
+		name += "::" + symbol.name;
+		if (symbol.isTemplate)
+			name += "<int>";
+		return name;
+	}
+
+	void openNamespaces(std::ostream &stream, const GeneratedProject::Symbol &symbol)
+	{
+		for (auto &ns : symbol.namespaces)
+			stream << "namespace " << ns << " { ";
+	}
+
+	void closeNamespaces(std::ostream &stream, const GeneratedProject::Symbol &symbol)
+	{
+		for (size_t i = 0; i < symbol.namespaces.size(); ++i)
+			stream << "} ";
+		stream << std::endl;
+	}
+
+	void addReference(GeneratedProject::Symbol &symbol, uint32_t target, architect::ReferenceType type)
+	{
+		for (auto &reference : symbol.references)
+		{
+			if (reference.target == target)
+				return;
+		}
+
+		GeneratedProject::Reference reference;
+		reference.target = target;
+		reference.type = type;
+		symbol.references.push_back(reference);
+	}
+}
+
+GeneratorParameters::GeneratorParameters()
+	: symbolCount(10000)
+	, namespaceDepth(3)
+	, namespaceFanOut(4)
+	, referenceFanOut(4)
+	, templateRatio(0.2f)
+	, cycleCount(10)
+	, cycleLength(4)
+	, seed(1)
+{}
+
+GeneratedProject generateProject(const GeneratorParameters &parameters)
+{
+	std::mt19937 random(parameters.seed);
+	std::uniform_real_distribution<float> ratio(0.0f, 1.0f);
+
+	uint32_t leafCount = 1;
+	for (uint32_t depth = 0; depth < parameters.namespaceDepth; ++depth)
+		leafCount *= std::max(1u, parameters.namespaceFanOut);
+	std::uniform_int_distribution<uint32_t> leaves(0, leafCount - 1);
+
+	GeneratedProject project;
+	project.symbols.resize(parameters.symbolCount);
+
+	for (uint32_t i = 0; i < parameters.symbolCount; ++i)
+	{
+		auto &symbol = project.symbols[i];
+
+		// digits of the leaf index give the path from the root namespace
+		uint32_t leaf = leaves(random);
+		for (uint32_t depth = 0; depth < parameters.namespaceDepth; ++depth)
+		{
+			symbol.namespaces.push_back("ns" + std::to_string(leaf % std::max(1u, parameters.namespaceFanOut)));
+			leaf /= std::max(1u, parameters.namespaceFanOut);
+		}
+
+		symbol.name = "Class" + std::to_string(i);
+		symbol.isTemplate = ratio(random) < parameters.templateRatio;
+
+		// only symbols defined before, so that the references alone are acyclic
+		uint32_t referenceCount = std::min(parameters.referenceFanOut, i);
+		for (uint32_t j = 0; j < referenceCount; ++j)
+		{
+			uint32_t target = std::uniform_int_distribution<uint32_t>(0, i - 1)(random);
+
+			architect::ReferenceType type = architect::ReferenceType::COMPOSITION;
+			if (j == 0 && ratio(random) < 0.25f)
+				type = architect::ReferenceType::INHERITANCE;
+			else if (ratio(random) < 0.5f)
+				type = architect::ReferenceType::ASSOCIATION;
+
+			addReference(symbol, target, type);
+		}
+	}
+
+	// pointers do not need the definition, so they can close cycles
+	// each cycle is planted in its own range of consecutive symbols, as the acyclic references only go to lower
+	// indices, no path leaves a range and comes back to it, which bounds the number of elementary cycles
+	uint32_t rangeCount = parameters.cycleLength > 1 ? parameters.symbolCount / parameters.cycleLength : 0;
+	if (rangeCount)
+	{
+		std::vector<uint32_t> ranges(rangeCount);
+		for (uint32_t i = 0; i < rangeCount; ++i)
+			ranges[i] = i;
+
+		uint32_t cycleCount = std::min(parameters.cycleCount, rangeCount);
+		for (uint32_t cycle = 0; cycle < cycleCount; ++cycle)
+		{
+			std::swap(ranges[cycle], ranges[std::uniform_int_distribution<uint32_t>(cycle, rangeCount - 1)(random)]);
+
+			uint32_t first = ranges[cycle] * parameters.cycleLength;
+			for (uint32_t j = 0; j < parameters.cycleLength; ++j)
+				addReference(project.symbols[first + j], first + (j + 1) % parameters.cycleLength, architect::ReferenceType::ASSOCIATION);
+		}
+	}
+
+	return project;
+}
+
+void fillRegistry(architect::Registry &registry, const GeneratedProject &project)
+{
+	std::vector<architect::Symbol *> symbols;
+	symbols.reserve(project.symbols.size());
+
+	for (auto &generatedSymbol : project.symbols)
+	{
+		architect::Namespace *ns = &registry.rootNameSpace;
+		for (auto &name : generatedSymbol.namespaces)
+			ns = registry.getOrCreateNamespace(ns, registry.strings.intern(name));
+
+		// same identifiers as the clang visitor
+		architect::SymbolIdentifier identifier;
+		identifier.name = registry.strings.intern(generatedSymbol.name);
+		identifier.type = generatedSymbol.isTemplate ? architect::StringPool::empty : identifier.name;
+
+		auto symbol = registry.getOrCreateSymbol(ns, identifier, generatedSymbol.isTemplate ? architect::SymbolType::RECORD_TEMPLATE : architect::SymbolType::RECORD);
+		symbol->defined = true;
+		if (generatedSymbol.isTemplate)
+			symbol->templateParameters.push_back("T");
+
+		symbols.push_back(symbol);
+	}
+
+	for (size_t i = 0; i < project.symbols.size(); ++i)
+	{
+		auto &generatedSymbol = project.symbols[i];
+		for (size_t j = 0; j < generatedSymbol.references.size(); ++j)
+		{
+			auto &generatedReference = generatedSymbol.references[j];
+
+			architect::Reference reference;
+			reference.location.filename = "generated.cpp";
+			reference.location.line = (uint32_t)i + 1;
+			reference.location.column = (uint32_t)j + 1;
+			reference.type = generatedReference.type;
+
+			symbols[i]->references[symbols[generatedReference.target]->id].insert(reference);
+		}
+	}
+}
+
+void writeSource(std::ostream &stream, const GeneratedProject &project)
+{
+	// all symbols are declared first, so that pointers can reference any of them
+	for (auto &symbol : project.symbols)
+	{
+		openNamespaces(stream, symbol);
+		if (symbol.isTemplate)
+			stream << "template <typename T> ";
+		stream << "class " << symbol.name << "; ";
+		closeNamespaces(stream, symbol);
+	}
+
+	for (auto &symbol : project.symbols)
+	{
+		stream << std::endl;
+		openNamespaces(stream, symbol);
+		stream << std::endl;
+
+		if (symbol.isTemplate)
+			stream << "template <typename T>" << std::endl;
+		stream << "class " << symbol.name;
+
+		bool hasBase = false;
+		for (auto &reference : symbol.references)
+		{
+			if (reference.type == architect::ReferenceType::INHERITANCE)
+			{
+				stream << (hasBase ? ", " : " : ") << "public " << getQualifiedName(project.symbols[reference.target]);
+				hasBase = true;
+			}
+		}
+
+		stream << std::endl << "{" << std::endl;
+		uint32_t memberIndex = 0;
+		for (auto &reference : symbol.references)
+		{
+			if (reference.type == architect::ReferenceType::INHERITANCE)
+				continue;
+
+			stream << "\t" << getQualifiedName(project.symbols[reference.target]);
+			if (reference.type == architect::ReferenceType::ASSOCIATION)
+				stream << " *";
+			else
+				stream << " ";
+			stream << "member" << memberIndex++ << ";" << std::endl;
+		}
+		stream << "};" << std::endl;
+
+		closeNamespaces(stream, symbol);
+	}
+}
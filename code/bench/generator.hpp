@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <architect.hpp>
+
+struct GeneratorParameters
+{
+	GeneratorParameters();
+
+	uint32_t symbolCount;
+	uint32_t namespaceDepth; // namespaces enclosing each symbol
+	uint32_t namespaceFanOut; // child namespaces per namespace
+	uint32_t referenceFanOut; // references per symbol, to symbols defined before it
+	float templateRatio; // part of the symbols being class templates
+	uint32_t cycleCount; // planted cycles, on top of the acyclic references
+	uint32_t cycleLength; // symbols per planted cycle
+	uint32_t seed;
+};
+
+// Synthetic project, the same one can be written as C++ source or filled into a registry.
+struct GeneratedProject
+{
+	struct Reference
+	{
+		uint32_t target; // symbol index
+		architect::ReferenceType type;
+	};
+
+	struct Symbol
+	{
+		std::vector<std::string> namespaces;
+		std::string name;
+		bool isTemplate;
+		std::vector<Reference> references;
+	};
+
+	std::vector<Symbol> symbols;
+};
+
+GeneratedProject generateProject(const GeneratorParameters &parameters);
+
+// same symbols and references as parsing the generated source, locations differ
+void fillRegistry(architect::Registry &registry, const GeneratedProject &project);
+
+// single translation unit, compiling without any include
+void writeSource(std::ostream &stream, const GeneratedProject &project);
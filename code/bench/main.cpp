@@ -0,0 +1,447 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <json.hpp>
+#include <architect.hpp>
+#include <cli.hpp>
+#include "baseline.hpp"
+#include "generator.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using json = nlohmann::json;
+
+// counted by the replaced global allocation functions
+std::atomic<uint64_t> allocationCount(0);
+std::atomic<uint64_t> allocatedBytes(0);
+
+void *operator new(size_t size)
+{
+	++allocationCount;
+	allocatedBytes += size;
+
+	void *pointer = malloc(size ? size : 1);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+	free(pointer);
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+	free(pointer);
+}
+
+// called instead of the unsized forms when the compiler knows the size
+void operator delete(void *pointer, size_t) noexcept
+{
+	free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+	free(pointer);
+}
+
+uint32_t repetitionCount;
+std::vector<Measure> measures;
+
+// peak resident set size in bytes, 0 if unknown
+uint64_t getPeakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage))
+		return 0;
+#ifdef __APPLE__
+	return (uint64_t)usage.ru_maxrss;
+#else
+	return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// the function returns the number of bytes read or written
+// the preparation is run before each repetition, and is not measured
+void measure(const char *name, bool guarded, uint64_t symbolCount, const std::function<uint64_t()> &function, const std::function<void()> &prepare = nullptr)
+{
+	Measure measure;
+	measure.name = name;
+	measure.guarded = guarded;
+	measure.symbolCount = symbolCount;
+
+	for (uint32_t i = 0; i < repetitionCount; ++i)
+	{
+		if (prepare)
+			prepare();
+
+		uint64_t startAllocationCount = allocationCount;
+		uint64_t startAllocatedBytes = allocatedBytes;
+
+		auto start = Clock::now();
+		measure.byteCount = function();
+		measure.durations.push_back(Clock::now() - start);
+
+		measure.allocationCount = allocationCount - startAllocationCount;
+		measure.allocatedBytes = allocatedBytes - startAllocatedBytes;
+	}
+
+	std::sort(measure.durations.begin(), measure.durations.end());
+	measure.peakMemory = getPeakMemory();
+
+	measures.push_back(measure);
+}
+
+uint64_t dump(const std::function<void(std::ostream &)> &function)
+{
+	std::ostringstream stream;
+	function(stream);
+	return stream.str().size();
+}
+
+json dumpParameters(const GeneratorParameters &parameters)
+{
+	json jParameters = json::object();
+	jParameters["symbolCount"] = parameters.symbolCount;
+	jParameters["namespaceDepth"] = parameters.namespaceDepth;
+	jParameters["namespaceFanOut"] = parameters.namespaceFanOut;
+	jParameters["referenceFanOut"] = parameters.referenceFanOut;
+	jParameters["templateRatio"] = std::round(parameters.templateRatio * 1e6) / 1e6; // prints as given, to compare after reloading
+	jParameters["cycleCount"] = parameters.cycleCount;
+	jParameters["cycleLength"] = parameters.cycleLength;
+	jParameters["seed"] = parameters.seed;
+	return jParameters;
+}
+
+int main(int argc, const char **argv)
+{
+	cli::Parser parser(argc, argv);
+
+	auto help = parser.defaultHelpFlag();
+
+	GeneratorParameters parameters;
+
+	parameters.symbolCount = parser.option("symbols")
+		.alias("s")
+		.defaultValue("10000")
+		.description("Number of generated classes")
+		.getValueAs<uint32_t>();
+
+	parameters.namespaceDepth = parser.option("depth")
+		.alias("d")
+		.defaultValue("3")
+		.description("Number of namespaces enclosing each class")
+		.getValueAs<uint32_t>();
+
+	parameters.namespaceFanOut = parser.option("namespaces")
+		.alias("n")
+		.defaultValue("4")
+		.description("Number of child namespaces per namespace")
+		.getValueAs<uint32_t>();
+
+	parameters.referenceFanOut = parser.option("fan-out")
+		.alias("f")
+		.defaultValue("4")
+		.description("Number of references per class")
+		.getValueAs<uint32_t>();
+
+	parameters.templateRatio = parser.option("templates")
+		.alias("t")
+		.defaultValue("0.2")
+		.description("Part of the classes being templates")
+		.getValueAs<float>();
+
+	parameters.cycleCount = parser.option("cycles")
+		.alias("c")
+		.defaultValue("10")
+		.description("Number of planted cycles")
+		.getValueAs<uint32_t>();
+
+	parameters.cycleLength = parser.option("cycle-length")
+		.alias("cl")
+		.defaultValue("4")
+		.description("Number of classes per planted cycle")
+		.getValueAs<uint32_t>();
+
+	parameters.seed = parser.option("seed")
+		.defaultValue("1")
+		.description("Seed of the generator")
+		.getValueAs<uint32_t>();
+
+	repetitionCount = std::max(1u, parser.option("repetitions")
+		.alias("r")
+		.defaultValue("5")
+		.description("Number of runs of each measure")
+		.getValueAs<uint32_t>());
+
+	auto baselineFilename = parser.option("baseline")
+		.alias("b")
+		.description("Compare with the results in this file, and fail on regressions of the guarded measures")
+		.getValue();
+
+	auto saveFilename = parser.option("save")
+		.description("Write the results to this file, to be used as baseline")
+		.getValue();
+
+	ComparisonParameters comparisonParameters;
+	comparisonParameters.tolerance = parser.option("tolerance")
+		.defaultValue("0.1")
+		.description("Accepted slowdown and allocation increase, relative to the baseline")
+		.getValueAs<float>();
+
+	bool skipCycles = parser.flag("no-cycles")
+		.description("Skip the enumeration of elementary cycles, which is exponential in the worst case")
+		.getValue();
+
+#ifdef ARCHITECT_CLANG_SUPPORT
+	bool skipClang = parser.flag("no-clang")
+		.description("Skip parsing the generated source")
+		.getValue();
+
+	auto sourceFilename = parser.option("source")
+		.defaultValue("bench.cpp")
+		.description("Temporary file receiving the generated source")
+		.getValue();
+
+	bool keepSource = parser.flag("keep-source")
+		.description("Do not delete the generated source")
+		.getValue();
+#endif
+
+	parser.help(help)
+		<< R"(architect.cpp benchmarks
+Generates a synthetic project, times each stage of the library on it and writes the results as JSON
+Usage: [options])";
+
+	if (help.getValue() || parser.hasErrors())
+		return EXIT_FAILURE;
+
+	json jParameters = dumpParameters(parameters);
+
+	json jBaseline;
+	if (baselineFilename)
+	{
+		std::ifstream baselineFile(baselineFilename);
+		if (!baselineFile.is_open())
+		{
+			std::cerr << "Cannot open file " << baselineFilename << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		try
+		{
+			baselineFile >> jBaseline;
+		}
+		catch (const std::exception &)
+		{
+			std::cerr << "Unable to parse " << baselineFilename << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		auto itBaselineParameters = jBaseline.find("parameters");
+		if (itBaselineParameters == jBaseline.end() || *itBaselineParameters != jParameters)
+		{
+			std::cerr << "The baseline was measured with other parameters" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	GeneratedProject project;
+	measure("generate", false, parameters.symbolCount, [&]
+	{
+		project = generateProject(parameters);
+		return 0;
+	});
+
+	architect::Registry registry;
+	measure("fill", false, parameters.symbolCount, [&]
+	{
+		fillRegistry(registry, project);
+		return 0;
+	}, [&]
+	{
+		registry.clear();
+	});
+
+#ifdef ARCHITECT_CLANG_SUPPORT
+	if (!skipClang)
+	{
+		std::ostringstream source;
+		writeSource(source, project);
+		uint64_t sourceSize = source.str().size();
+
+		{
+			std::ofstream sourceFile(sourceFilename);
+			if (!sourceFile.is_open())
+			{
+				std::cerr << "Cannot open file " << sourceFilename << std::endl;
+				return EXIT_FAILURE;
+			}
+			sourceFile << source.str();
+		}
+
+		const char *clangArgv[2] = { argv[0], sourceFilename };
+		architect::Registry clangRegistry;
+		bool succeeded = true;
+		measure("clang::parse", true, parameters.symbolCount, [&]
+		{
+			succeeded = architect::clang::parse(clangRegistry, 2, clangArgv) && succeeded;
+			return sourceSize;
+		}, [&]
+		{
+			clangRegistry.clear();
+		});
+
+		if (!keepSource)
+			std::remove(sourceFilename);
+
+		if (!succeeded)
+		{
+			std::cerr << "Unable to parse the generated source" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+#endif
+
+#ifdef ARCHITECT_JSON_SUPPORT
+	std::string jsonDump;
+	measure("json::dumpSymbols", true, parameters.symbolCount, [&]
+	{
+		std::ostringstream stream;
+		architect::json::dumpSymbols(registry.getSymbols(), stream);
+		jsonDump = stream.str();
+		return jsonDump.size();
+	});
+
+	bool parsed = true;
+	architect::Registry jsonRegistry;
+	measure("json::parse", true, parameters.symbolCount, [&]
+	{
+		std::istringstream stream(jsonDump);
+		parsed = architect::json::parse(jsonRegistry, stream) && parsed;
+		return jsonDump.size();
+	}, [&]
+	{
+		jsonRegistry.clear();
+	});
+
+	if (!parsed || !(jsonRegistry == registry))
+	{
+		std::cerr << "The JSON round-trip does not give back the registry" << std::endl;
+		return EXIT_FAILURE;
+	}
+#endif
+
+	measure("computeScc", true, parameters.symbolCount, [&]
+	{
+		registry.computeScc();
+		return 0;
+	});
+
+	if (!skipCycles)
+	{
+		measure("computeCycles", false, parameters.symbolCount, [&]
+		{
+			registry.computeCycles();
+			return 0;
+		});
+	}
+
+	// on a copy, the other measures need the redundant dependencies
+	architect::Registry reducedRegistry;
+	measure("removeRedundantDependencies", false, parameters.symbolCount, [&]
+	{
+		reducedRegistry.removeRedundantDependencies();
+		return 0;
+	}, [&]
+	{
+		reducedRegistry.copy(registry);
+	});
+
+#ifdef ARCHITECT_CONSOLE_SUPPORT
+	measure("console::dumpSymbols", false, parameters.symbolCount, [&]
+	{
+		return dump([&](std::ostream &stream)
+		{
+			architect::console::dumpSymbols(registry.getSymbols(), stream);
+		});
+	});
+#endif
+
+#ifdef ARCHITECT_DOT_SUPPORT
+	measure("dot::dumpSymbols", false, parameters.symbolCount, [&]
+	{
+		return dump([&](std::ostream &stream)
+		{
+			architect::dot::dumpSymbols(registry.getSymbols(), stream);
+		});
+	});
+#endif
+
+#ifdef ARCHITECT_SVG_SUPPORT
+	measure("svg::dumpSymbols", false, parameters.symbolCount, [&]
+	{
+		return dump([&](std::ostream &stream)
+		{
+			architect::svg::dumpSymbols(registry.getSymbols(), stream);
+		});
+	});
+#endif
+
+	json jResults = dumpMeasures(measures, jParameters);
+	jResults["peakMemory"] = getPeakMemory();
+
+	if (saveFilename)
+	{
+		std::ofstream saveFile(saveFilename);
+		if (!saveFile.is_open())
+		{
+			std::cerr << "Cannot open file " << saveFilename << std::endl;
+			return EXIT_FAILURE;
+		}
+		saveFile << jResults.dump(2) << std::endl;
+	}
+
+	bool succeeded = true;
+	if (baselineFilename)
+	{
+		json jComparisons;
+		succeeded = compareMeasures(measures, jBaseline, jComparisons, comparisonParameters);
+		jResults["comparisons"] = jComparisons;
+
+		for (auto &jComparison : jComparisons)
+		{
+			if (jComparison["guarded"] && (jComparison["slower"] || jComparison["moreAllocations"]))
+				std::cerr << "Regression: " << jComparison["name"].get<std::string>() << std::endl;
+		}
+	}
+
+	std::cout << jResults.dump(2) << std::endl;
+
+	return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
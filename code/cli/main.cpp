@@ -1,15 +1,19 @@
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <architect.hpp>
 #include <cli.hpp>
+#include "server.hpp"
 
 enum class Format
 {
 	DEFAULT,
+	AST,
 	CLANG,
 	CONSOLE,
 	DOT,
 	JSON,
+	SVG,
 	UNKNOWN,
 };
 
@@ -17,6 +21,8 @@ Format getFormat(const char *option)
 {
 	if (!option)
 		return Format::DEFAULT;
+	if (!strcmp(option, "ast"))
+		return Format::AST;
 	if (!strcmp(option, "clang"))
 		return Format::CLANG;
 	if (!strcmp(option, "console"))
@@ -25,11 +31,53 @@ Format getFormat(const char *option)
 		return Format::DOT;
 	if (!strcmp(option, "json"))
 		return Format::JSON;
+	if (!strcmp(option, "svg"))
+		return Format::SVG;
 	return Format::UNKNOWN;
 }
 
 Format inputFormat;
 bool workingDirectory;
+const char *compilationDatabase;
+uint32_t jobCount;
+bool sharedPCH;
+const char *pchDirectory;
+const char *astCacheDirectory;
+bool pruneExternal;
+const char *externalDirectories;
+bool includeGraph;
+architect::Stats *stats;
+
+#ifdef ARCHITECT_CLANG_SUPPORT
+architect::clang::Parameters getClangParameters()
+{
+	architect::clang::Parameters parameters;
+	if (workingDirectory)
+		parameters.filter = architect::clang::DirectoryFilter();
+	parameters.stats = stats;
+
+	parameters.pruneExternal = pruneExternal;
+	parameters.includeGraph = includeGraph;
+	if (externalDirectories)
+	{
+		// separated as in the PATH environment variable
+#ifdef _WIN32
+		const char separator = ';';
+#else
+		const char separator = ':';
+#endif
+		std::istringstream stream(externalDirectories);
+		std::string directory;
+		while (std::getline(stream, directory, separator))
+		{
+			if (!directory.empty())
+				parameters.externalDirectories.push_back(directory);
+		}
+	}
+
+	return parameters;
+}
+#endif
 
 bool loadRegistry(architect::Registry &registry, int argc, const char **argv)
 {
@@ -40,17 +88,53 @@ bool loadRegistry(architect::Registry &registry, int argc, const char **argv)
 #ifdef ARCHITECT_CLANG_SUPPORT
 	case Format::CLANG:
 	{
-		architect::clang::Parameters parameters;
-		if (workingDirectory)
-			parameters.filter = architect::clang::DirectoryFilter();
+		auto parameters = getClangParameters();
+
+		architect::clang::SessionParameters sessionParameters;
+		sessionParameters.excludeDeclarationsFromPCH = sharedPCH;
+		if (astCacheDirectory)
+			sessionParameters.astCacheDirectory = astCacheDirectory;
+		architect::clang::Session session(sessionParameters);
+
+		if (compilationDatabase)
+		{
+			architect::clang::CompilationDatabaseParameters databaseParameters;
+			databaseParameters.jobCount = jobCount;
+			databaseParameters.sharedPCH = sharedPCH;
+			if (pchDirectory)
+				databaseParameters.pchDirectory = pchDirectory;
+
+			if (!architect::clang::parseCompilationDatabase(registry, session, compilationDatabase, databaseParameters, parameters))
+			{
+				std::cerr << "Unable to parse the compilation database of " << compilationDatabase << std::endl;
+				return false;
+			}
+			return true;
+		}
 
-		if (!architect::clang::parse(registry, argc, argv, parameters))
+		if (!architect::clang::parse(registry, session, argc, argv, parameters))
 		{
 			std::cerr << "Unable to parse" << std::endl;
 			return false;
 		}
 		return true;
 	}
+
+	case Format::AST:
+	{
+		auto parameters = getClangParameters();
+
+		architect::clang::Session session;
+		for (int i = 1; i < argc; ++i)
+		{
+			if (!architect::clang::load(registry, session, argv[i], parameters))
+			{
+				std::cerr << "Unable to load " << argv[i] << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
 #endif
 
 #ifdef ARCHITECT_JSON_SUPPORT
@@ -64,6 +148,8 @@ bool loadRegistry(architect::Registry &registry, int argc, const char **argv)
 				return false;
 			}
 
+			architect::ScopedTimer timer(stats, "load");
+			timer.setDetail(argv[i]);
 			if (!architect::json::parse(registry, file))
 			{
 				std::cerr << "Unable to parse " << argv[i] << std::endl;
@@ -92,6 +178,41 @@ int main(int argc, const char **argv)
 		.description("Restrict symbol definitions to working directory and subdirectories")
 		.getValue();
 
+	compilationDatabase = parser.option("compilation-database")
+		.alias("cdb")
+		.description("Parse the translation units of the compile_commands.json file in this build directory, instead of the files given (clang)")
+		.getValue();
+
+	jobCount = parser.option("jobs")
+		.alias("j")
+		.defaultValue("0")
+		.description("Translation units of the compilation database parsed concurrently, 0 for hardware concurrency (clang)")
+		.getValueAs<uint32_t>();
+
+	sharedPCH = parser.flag("pch")
+		.description("Precompile the system headers included first by every translation unit of the compilation database, and parse them once (clang)")
+		.getValue();
+
+	pchDirectory = parser.option("pch-dir")
+		.description("Directory receiving the precompiled header of -pch while parsing, the temporary directory by default (clang)")
+		.getValue();
+
+	astCacheDirectory = parser.option("ast-cache")
+		.description("Save the parsed translation units in this directory, and load them back in later runs while their files are unchanged (clang)")
+		.getValue();
+
+	pruneExternal = parser.flag("prune-external")
+		.description("Skip the declarations of system headers and external directories, keeping placeholders for the symbols referenced there (clang)")
+		.getValue();
+
+	externalDirectories = parser.option("external")
+		.description("Include roots of third-party headers, separated as in PATH, skipped with -prune-external (clang)")
+		.getValue();
+
+	includeGraph = parser.flag("includes")
+		.description("Extract the graph of file inclusions instead of the symbols, e.g. to find include cycles with scc or cycles (clang)")
+		.getValue();
+
 	auto input = parser.option("input")
 		.alias("i")
 		.description("Set input format")
@@ -108,6 +229,100 @@ int main(int argc, const char **argv)
 	if (outputFormat == Format::UNKNOWN)
 		parser.reportError("Unknown output format: %s", output);
 
+	architect::Stats commandStats;
+	bool displayStats = parser.flag("stats")
+		.description("Display timings and counters on the error output")
+		.getValue();
+
+	architect::Trace trace;
+	auto traceFilename = parser.option("trace")
+		.description("Write a timeline of the phases to this file, in Chrome trace event format")
+		.getValue();
+	if (traceFilename)
+		commandStats.setTrace(&trace);
+
+	stats = displayStats || traceFilename ? &commandStats : nullptr;
+
+#ifdef ARCHITECT_CLANG_SUPPORT
+	parser.command("cost")
+		.description("Rank headers by estimated compile time")
+		.execute([&](cli::Parser &parser)
+	{
+		parser.help()
+			<< R"(Rank headers by estimated compile time, the headers whose removal or splitting would save the most first
+Usage: cost [options] [clang arguments])";
+
+		uint32_t limit = parser.option("limit")
+			.alias("n")
+			.defaultValue("0")
+			.description("Number of headers shown, 0 for all")
+			.getValueAs<uint32_t>();
+
+		bool pretty = parser.flag("pretty")
+			.alias("p")
+			.description("Pretty print with indentations and line returns")
+			.getValue();
+
+		parser.getRemainingArguments(argc, argv);
+		if (inputFormat != Format::DEFAULT && inputFormat != Format::CLANG)
+		{
+			std::cerr << "Unsupported input format for this command" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		auto parameters = getClangParameters();
+		architect::clang::Session session;
+		architect::HeaderCosts costs;
+		if (compilationDatabase)
+		{
+			architect::clang::CompilationDatabaseParameters databaseParameters;
+			databaseParameters.jobCount = jobCount;
+
+			if (!architect::clang::computeHeaderCosts(costs, session, compilationDatabase, databaseParameters, parameters))
+			{
+				std::cerr << "Unable to parse the compilation database of " << compilationDatabase << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (!architect::clang::computeHeaderCosts(costs, session, argc, argv, parameters))
+		{
+			std::cerr << "Unable to parse" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		if (limit && costs.size() > limit)
+			costs.resize(limit);
+
+		architect::ScopedTimer outputTimer(stats, "output");
+		switch (outputFormat)
+		{
+		case Format::DEFAULT:
+
+#ifdef ARCHITECT_CONSOLE_SUPPORT
+		case Format::CONSOLE:
+			architect::console::dumpHeaderCosts(costs, std::cout);
+			break;
+#endif
+
+#ifdef ARCHITECT_JSON_SUPPORT
+		case Format::JSON:
+		{
+			architect::json::FormattingParameters parameters;
+			parameters.pretty = pretty;
+			architect::json::dumpHeaderCosts(costs, std::cout, parameters);
+			break;
+		}
+#endif
+
+		default:
+			std::cerr << "Unsupported output format for this command" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		return EXIT_SUCCESS;
+	});
+#endif
+
 	parser.command("cycles")
 		.alias("c")
 		.description("Show dependency cycles")
@@ -134,8 +349,10 @@ Usage: cycles [options])";
 
 		architect::ComputeCyclesParameters parameters;
 		parameters.minCardinality = minCardinalty;
+		parameters.stats = stats;
 		auto cycles = registry.computeCycles(parameters);
 
+		architect::ScopedTimer outputTimer(stats, "output");
 		switch (outputFormat)
 		{
 		case Format::DEFAULT:
@@ -193,12 +410,72 @@ Usage: dependencies [options])";
 				.description("Pretty print with indentations and line returns")
 				.getValue();
 
+			bool clusterNamespaces = parser.flag("clusters")
+				.description("Group symbols in clusters following their namespaces (dot)")
+				.getValue();
+
+			int32_t collapseDepth = parser.option("collapse-depth")
+				.alias("cd")
+				.defaultValue("-1")
+				.description("Collapse symbols deeper than this namespace depth (dot, svg)")
+				.getValueAs<int32_t>();
+
+			bool stableIds = parser.flag("stable-ids")
+				.alias("si")
+				.description("Derive node ids from names so that they do not change between runs (dot)")
+				.getValue();
+
+			auto focus = parser.option("focus")
+				.description("Only show symbols around the symbols with this qualified or full name")
+				.getValue();
+
+			architect::ComputeNeighborhoodParameters neighborhoodParameters;
+
+			neighborhoodParameters.radius = parser.option("radius")
+				.defaultValue("1")
+				.description("Maximum number of references from the focus")
+				.getValueAs<uint32_t>();
+
+			auto direction = parser.option("direction")
+				.alias("dir")
+				.defaultValue("both")
+				.description("Follow references from the focus (out), to the focus (in), or both")
+				.getValue();
+			if (!strcmp(direction, "in"))
+				neighborhoodParameters.direction = architect::NeighborhoodDirection::IN;
+			else if (!strcmp(direction, "out"))
+				neighborhoodParameters.direction = architect::NeighborhoodDirection::OUT;
+			else if (!strcmp(direction, "both"))
+				neighborhoodParameters.direction = architect::NeighborhoodDirection::BOTH;
+			else
+				parser.reportError("Unknown direction: %s", direction);
+
+			uint32_t threadCount = parser.option("threads")
+				.defaultValue("0")
+				.description("Threads for layout, 0 for hardware concurrency (svg)")
+				.getValueAs<uint32_t>();
+
 			parser.getRemainingArguments(argc, argv);
 			if (!loadRegistry(registry, argc, argv))
 				return EXIT_FAILURE;
 
-			auto &symbols = registry.getSymbols();
+			architect::Symbols neighborhood;
+			if (focus)
+			{
+				auto focusSymbols = registry.findSymbols(focus);
+				if (focusSymbols.empty())
+				{
+					std::cerr << "No symbol named " << focus << std::endl;
+					return EXIT_FAILURE;
+				}
+
+				architect::ScopedTimer timer(stats, "neighborhood");
+				neighborhood = registry.computeNeighborhood(focusSymbols, neighborhoodParameters);
+			}
+
+			auto &symbols = focus ? neighborhood : registry.getSymbols();
 
+			architect::ScopedTimer outputTimer(stats, "output");
 			switch (outputFormat)
 			{
 			case Format::DEFAULT:
@@ -213,8 +490,11 @@ Usage: dependencies [options])";
 			case Format::DOT:
 			{
 				architect::dot::FormattingParameters parameters;
+				parameters.clusterNamespaces = clusterNamespaces;
+				parameters.collapseDepth = collapseDepth;
 				parameters.displayReferenceCount = displayReferenceCount;
 				parameters.pretty = pretty;
+				parameters.stableIds = stableIds;
 				architect::dot::dumpSymbols(symbols, std::cout, parameters);
 				break;
 			}
@@ -230,6 +510,17 @@ Usage: dependencies [options])";
 			}
 #endif
 
+#ifdef ARCHITECT_SVG_SUPPORT
+			case Format::SVG:
+			{
+				architect::svg::FormattingParameters parameters;
+				parameters.collapseDepth = collapseDepth;
+				parameters.threadCount = threadCount;
+				architect::svg::dumpSymbols(symbols, std::cout, parameters);
+				break;
+			}
+#endif
+
 			default:
 				parser.reportError("Unsupported input format for this command: %s", input);
 				break;
@@ -238,6 +529,160 @@ Usage: dependencies [options])";
 			return EXIT_SUCCESS;
 		});
 
+	parser.command("diff")
+		.description("Show architecture changes between two inputs")
+		.execute([&](cli::Parser &parser)
+	{
+		parser.help()
+			<< R"(Show added and removed symbols and dependencies, and changed dependency types
+Usage: diff [options] <previous> <current>)";
+
+		bool pretty = parser.flag("pretty")
+			.alias("p")
+			.description("Pretty print with indentations and line returns")
+			.getValue();
+
+		parser.getRemainingArguments(argc, argv);
+		if (argc != 3)
+		{
+			std::cerr << "Two inputs are required" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		architect::Registry previousRegistry;
+		const char *previousArgv[] = { argv[0], argv[1] };
+		if (!loadRegistry(previousRegistry, 2, previousArgv))
+			return EXIT_FAILURE;
+
+		const char *currentArgv[] = { argv[0], argv[2] };
+		if (!loadRegistry(registry, 2, currentArgv))
+			return EXIT_FAILURE;
+
+		architect::Diff diff;
+		{
+			architect::ScopedTimer timer(stats, "diff");
+			diff = registry.computeDiff(previousRegistry);
+		}
+
+		architect::ScopedTimer outputTimer(stats, "output");
+		switch (outputFormat)
+		{
+		case Format::DEFAULT:
+
+#ifdef ARCHITECT_CONSOLE_SUPPORT
+		case Format::CONSOLE:
+			architect::console::dumpDiff(diff, std::cout);
+			break;
+#endif
+
+#ifdef ARCHITECT_DOT_SUPPORT
+		case Format::DOT:
+		{
+			architect::dot::FormattingParameters parameters;
+			parameters.pretty = pretty;
+			architect::dot::dumpDiff(diff, std::cout, parameters);
+			break;
+		}
+#endif
+
+#ifdef ARCHITECT_JSON_SUPPORT
+		case Format::JSON:
+		{
+			architect::json::FormattingParameters parameters;
+			parameters.pretty = pretty;
+			architect::json::dumpDiff(diff, std::cout, parameters);
+			break;
+		}
+#endif
+
+		default:
+			std::cerr << "Unsupported output format for this command" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		return diff.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+	});
+
+	parser.command("fingerprint")
+		.alias("f")
+		.description("Show registry fingerprint")
+		.execute([&](cli::Parser &parser)
+	{
+		parser.help()
+			<< R"(Show registry fingerprint, independent of symbol order
+Usage: fingerprint [options])";
+
+		parser.getRemainingArguments(argc, argv);
+		if (!loadRegistry(registry, argc, argv))
+			return EXIT_FAILURE;
+
+		architect::Fingerprint fingerprint;
+		{
+			architect::ScopedTimer timer(stats, "fingerprint");
+			fingerprint = registry.computeFingerprint();
+		}
+
+		architect::ScopedTimer outputTimer(stats, "output");
+		switch (outputFormat)
+		{
+		case Format::DEFAULT:
+
+#ifdef ARCHITECT_CONSOLE_SUPPORT
+		case Format::CONSOLE:
+			std::cout << fingerprint.toString() << "\n";
+			break;
+#endif
+
+#ifdef ARCHITECT_JSON_SUPPORT
+		case Format::JSON:
+			std::cout << nlohmann::json(fingerprint.toString()).dump() << "\n";
+			break;
+#endif
+
+		default:
+			std::cerr << "Unsupported output format for this command" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		return EXIT_SUCCESS;
+	});
+
+#ifndef _WIN32
+	parser.command("serve")
+		.description("Answer queries over a Unix domain socket")
+		.execute([&](cli::Parser &parser)
+	{
+		parser.help()
+			<< R"(Answer JSON queries over a Unix domain socket, one query per line
+Usage: serve [options]
+Queries:
+  {"query": "dependencies", "symbol": "A", "direction": "in|out|both", "radius": 1}
+  {"query": "cycle", "symbol": "A"}
+  {"query": "path", "from": "A", "to": "B"}
+  {"query": "impact", "file": "a.cpp"})";
+
+		ServerParameters parameters;
+
+		parameters.socketPath = parser.option("socket")
+			.alias("s")
+			.defaultValue("architect.sock")
+			.description("Path of the socket")
+			.getValue();
+
+		parameters.threadCount = parser.option("threads")
+			.defaultValue("0")
+			.description("Threads answering queries, 0 for hardware concurrency")
+			.getValueAs<uint32_t>();
+
+		parser.getRemainingArguments(argc, argv);
+		if (!loadRegistry(registry, argc, argv))
+			return EXIT_FAILURE;
+
+		architect::QueryIndex index(registry);
+		return serve(index, parameters) ? EXIT_SUCCESS : EXIT_FAILURE;
+	});
+#endif
+
 	parser.command("scc")
 		.description("Show strongly connect components")
 		.execute([&](cli::Parser &parser)
@@ -263,8 +708,10 @@ Usage: scc [options])";
 
 		architect::ComputeCyclesParameters parameters;
 		parameters.minCardinality = minCardinalty;
+		parameters.stats = stats;
 		auto cycles = registry.computeScc(parameters);
 
+		architect::ScopedTimer outputTimer(stats, "output");
 		switch (outputFormat)
 		{
 		case Format::DEFAULT:
@@ -316,5 +763,38 @@ Usage: <command> [options])";
 		return EXIT_FAILURE;
 	}
 
+	if (traceFilename)
+	{
+		std::ofstream traceFile(traceFilename);
+		if (!traceFile.is_open())
+		{
+			std::cerr << "Cannot open file " << traceFilename << std::endl;
+			return EXIT_FAILURE;
+		}
+		trace.write(traceFile);
+	}
+
+	if (displayStats)
+	{
+#ifdef ARCHITECT_ALLOCATION_TRACKING
+		architect::addAllocationCounters(commandStats);
+#endif
+
+		switch (outputFormat)
+		{
+#ifdef ARCHITECT_JSON_SUPPORT
+		case Format::JSON:
+			architect::json::dumpStats(commandStats, std::cerr);
+			break;
+#endif
+
+		default:
+#ifdef ARCHITECT_CONSOLE_SUPPORT
+			architect::console::dumpStats(commandStats, std::cerr);
+#endif
+			break;
+		}
+	}
+
 	return result;
 }
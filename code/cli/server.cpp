@@ -0,0 +1,505 @@
+#include "server.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <json.hpp>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	typedef nlohmann::json _json;
+
+	_json error(const std::string &message)
+	{
+		_json jAnswer = _json::object();
+		jAnswer["error"] = message;
+		return jAnswer;
+	}
+
+	bool getString(const _json &jQuery, const char *name, std::string &value)
+	{
+		auto it = jQuery.find(name);
+		if (it == jQuery.end() || !it->is_string())
+			return false;
+		value = it->get<std::string>();
+		return true;
+	}
+
+	_json dumpNames(const architect::Symbols &symbols)
+	{
+		_json jNames = _json::array();
+		for (auto &pair : symbols)
+			jNames.push_back(pair.second->getFullName());
+		return jNames;
+	}
+
+	_json dumpNames(const std::vector<const architect::Symbol *> &symbols)
+	{
+		_json jNames = _json::array();
+		for (auto symbol : symbols)
+			jNames.push_back(symbol->getFullName());
+		return jNames;
+	}
+
+	// property holding the name of one or several symbols
+	bool findSymbols(const architect::QueryIndex &index, const _json &jQuery, const char *name, architect::Symbols &symbols, _json &jError)
+	{
+		std::string symbolName;
+		if (!getString(jQuery, name, symbolName))
+		{
+			jError = error(std::string("Missing string property: ") + name);
+			return false;
+		}
+
+		symbols = index.findSymbols(symbolName);
+		if (symbols.empty())
+		{
+			jError = error("No symbol named " + symbolName);
+			return false;
+		}
+
+		return true;
+	}
+
+	// property holding the name of exactly one symbol
+	bool findSymbol(const architect::QueryIndex &index, const _json &jQuery, const char *name, const architect::Symbol *&symbol, _json &jError)
+	{
+		architect::Symbols symbols;
+		if (!findSymbols(index, jQuery, name, symbols, jError))
+			return false;
+
+		if (symbols.size() > 1)
+		{
+			jError = error("Ambiguous name, use one of the full names");
+			jError["candidates"] = dumpNames(symbols);
+			return false;
+		}
+
+		symbol = symbols.begin()->second;
+		return true;
+	}
+
+	_json answerDependencies(const architect::QueryIndex &index, const _json &jQuery)
+	{
+		_json jError;
+		architect::Symbols focus;
+		if (!findSymbols(index, jQuery, "symbol", focus, jError))
+			return jError;
+
+		architect::ComputeNeighborhoodParameters parameters;
+		parameters.direction = architect::NeighborhoodDirection::OUT;
+
+		std::string direction;
+		if (getString(jQuery, "direction", direction))
+		{
+			if (direction == "in")
+				parameters.direction = architect::NeighborhoodDirection::IN;
+			else if (direction == "out")
+				parameters.direction = architect::NeighborhoodDirection::OUT;
+			else if (direction == "both")
+				parameters.direction = architect::NeighborhoodDirection::BOTH;
+			else
+				return error("Unknown direction: " + direction);
+		}
+
+		auto itRadius = jQuery.find("radius");
+		if (itRadius != jQuery.end())
+		{
+			if (!itRadius->is_number_integer() || itRadius->get<int64_t>() < 0)
+				return error("Radius must be a positive integer");
+			parameters.radius = itRadius->get<uint32_t>();
+		}
+
+		_json jAnswer = _json::object();
+		jAnswer["symbols"] = dumpNames(index.computeNeighborhood(focus, parameters));
+		return jAnswer;
+	}
+
+	_json answerCycle(const architect::QueryIndex &index, const _json &jQuery)
+	{
+		_json jError;
+		const architect::Symbol *symbol;
+		if (!findSymbol(index, jQuery, "symbol", symbol, jError))
+			return jError;
+
+		_json jAnswer = _json::object();
+		jAnswer["symbols"] = dumpNames(index.getCycle(symbol));
+		return jAnswer;
+	}
+
+	_json answerPath(const architect::QueryIndex &index, const _json &jQuery)
+	{
+		_json jError;
+		const architect::Symbol *from;
+		if (!findSymbol(index, jQuery, "from", from, jError))
+			return jError;
+
+		const architect::Symbol *to;
+		if (!findSymbol(index, jQuery, "to", to, jError))
+			return jError;
+
+		_json jAnswer = _json::object();
+		jAnswer["symbols"] = dumpNames(index.findPath(from, to));
+		return jAnswer;
+	}
+
+	_json answerImpact(const architect::QueryIndex &index, const _json &jQuery)
+	{
+		std::string filename;
+		if (!getString(jQuery, "file", filename))
+			return error("Missing string property: file");
+
+		_json jAnswer = _json::object();
+		jAnswer["symbols"] = dumpNames(index.computeFileImpact(filename));
+		return jAnswer;
+	}
+
+#ifndef _WIN32
+	struct Connection
+	{
+		Connection(int socket)
+			: socket(socket)
+			, busy(false)
+			, ended(false)
+			, failed(false)
+		{}
+
+		int socket;
+		std::string buffer; // partial line, only used by the polling thread
+
+		// guarded by the query queue
+		std::deque<std::string> queries;
+		bool busy; // a worker is answering one of the queries
+		bool ended; // no more queries, closed once answered
+		bool failed; // answers cannot be sent anymore
+	};
+
+	// Hands received queries over to the worker threads, one query at a time so that persistent connections share the workers.
+	// Queries of a connection are answered in order, the connection going back to the end of the queue after each one.
+	class QueryQueue
+	{
+	public:
+		QueryQueue()
+			: _stopped(false)
+		{}
+
+		void push(const std::shared_ptr<Connection> &connection, std::string query)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (connection->failed)
+					return;
+
+				connection->queries.push_back(std::move(query));
+				if (connection->busy)
+					return;
+
+				connection->busy = true;
+				_connections.push_back(connection);
+			}
+			_condition.notify_one();
+		}
+
+		// false once stopped
+		bool pop(std::shared_ptr<Connection> &connection, std::string &query)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this]
+			{
+				return _stopped || !_connections.empty();
+			});
+			if (_stopped)
+				return false;
+
+			connection = _connections.front();
+			_connections.pop_front();
+			query = std::move(connection->queries.front());
+			connection->queries.pop_front();
+			return true;
+		}
+
+		void done(const std::shared_ptr<Connection> &connection, bool sent)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (!sent)
+				{
+					connection->failed = true;
+					connection->queries.clear();
+				}
+
+				if (connection->queries.empty())
+				{
+					connection->busy = false;
+					if (connection->ended)
+						close(connection->socket);
+					return;
+				}
+
+				_connections.push_back(connection);
+			}
+			_condition.notify_one();
+		}
+
+		// the connection is not polled anymore
+		void end(const std::shared_ptr<Connection> &connection)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			connection->ended = true;
+			if (!connection->busy)
+				close(connection->socket);
+		}
+
+		void stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stopped = true;
+			}
+			_condition.notify_all();
+		}
+
+	private:
+		std::mutex _mutex;
+		std::condition_variable _condition;
+		std::deque<std::shared_ptr<Connection>> _connections;
+		bool _stopped;
+	};
+
+	bool sendAll(int connection, const std::string &data)
+	{
+		size_t sent = 0;
+		while (sent < data.size())
+		{
+			ssize_t result = send(connection, data.data() + sent, data.size() - sent, 0);
+			if (result < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+			sent += (size_t)result;
+		}
+		return true;
+	}
+
+	// only removes sockets, so that a mistyped path never deletes another file
+	bool removeSocketFile(const std::string &path)
+	{
+		struct stat status;
+		if (lstat(path.c_str(), &status))
+			return errno == ENOENT;
+		if (!S_ISSOCK(status.st_mode))
+		{
+			errno = EEXIST;
+			return false;
+		}
+		return !unlink(path.c_str());
+	}
+
+	// false when the connection must be closed
+	bool receiveQueries(const std::shared_ptr<Connection> &connection, size_t maxQueryLength, QueryQueue &queries)
+	{
+		char chunk[4096];
+		ssize_t received;
+		do
+		{
+			received = recv(connection->socket, chunk, sizeof(chunk), 0);
+		} while (received < 0 && errno == EINTR);
+		if (received <= 0)
+			return false;
+
+		std::string &buffer = connection->buffer;
+		buffer.append(chunk, (size_t)received);
+
+		size_t begin = 0;
+		for (size_t end = buffer.find('\n'); end != std::string::npos; end = buffer.find('\n', begin))
+		{
+			if (end - begin > maxQueryLength)
+				return false;
+
+			queries.push(connection, buffer.substr(begin, end - begin));
+			begin = end + 1;
+		}
+		buffer.erase(0, begin);
+
+		// a client never ending its line must not exhaust the memory
+		return buffer.size() <= maxQueryLength;
+	}
+#endif
+}
+
+ServerParameters::ServerParameters()
+	: socketPath("architect.sock")
+	, threadCount(0)
+	, maxQueryLength(1 << 20)
+{}
+
+std::string answerQuery(const architect::QueryIndex &index, const std::string &query)
+{
+	_json jQuery;
+	try
+	{
+		jQuery = _json::parse(query);
+	}
+	catch (const std::exception &)
+	{
+		return error("Invalid JSON").dump();
+	}
+
+	if (!jQuery.is_object())
+		return error("Query must be an object").dump();
+
+	std::string type;
+	if (!getString(jQuery, "query", type))
+		return error("Missing string property: query").dump();
+
+	if (type == "dependencies")
+		return answerDependencies(index, jQuery).dump();
+	if (type == "cycle")
+		return answerCycle(index, jQuery).dump();
+	if (type == "path")
+		return answerPath(index, jQuery).dump();
+	if (type == "impact")
+		return answerImpact(index, jQuery).dump();
+
+	return error("Unknown query: " + type).dump();
+}
+
+#ifndef _WIN32
+bool serve(const architect::QueryIndex &index, const ServerParameters &parameters)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (parameters.socketPath.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "Socket path is too long: " << parameters.socketPath << std::endl;
+		return false;
+	}
+	strcpy(address.sun_path, parameters.socketPath.c_str());
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0)
+	{
+		std::cerr << "Cannot create socket: " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	// a previous server may have left its socket file
+	if (!removeSocketFile(parameters.socketPath))
+	{
+		std::cerr << "Cannot replace " << parameters.socketPath << ": " << (errno == EEXIST ? "not a socket" : strerror(errno)) << std::endl;
+		close(listener);
+		return false;
+	}
+
+	if (bind(listener, (const sockaddr *)&address, sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0)
+	{
+		std::cerr << "Cannot listen on " << parameters.socketPath << ": " << strerror(errno) << std::endl;
+		close(listener);
+		return false;
+	}
+
+	// clients closing early must not kill the server
+	signal(SIGPIPE, SIG_IGN);
+
+	uint32_t threadCount = parameters.threadCount;
+	if (!threadCount)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	QueryQueue queries;
+	std::vector<std::thread> workers;
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		workers.push_back(std::thread([&index, &queries]
+		{
+			std::shared_ptr<Connection> connection;
+			std::string query;
+			while (queries.pop(connection, query))
+				queries.done(connection, sendAll(connection->socket, answerQuery(index, query) + '\n'));
+		}));
+	}
+
+	std::cerr << "Listening on " << parameters.socketPath << std::endl;
+
+	// the listener first, then the connections in the same order
+	std::vector<pollfd> descriptors(1);
+	descriptors[0].fd = listener;
+	descriptors[0].events = POLLIN;
+	std::vector<std::shared_ptr<Connection>> connections;
+
+	for (;;)
+	{
+		if (poll(descriptors.data(), (nfds_t)descriptors.size(), -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			std::cerr << "Cannot poll connections: " << strerror(errno) << std::endl;
+			break;
+		}
+
+		for (size_t i = connections.size(); i > 0; --i)
+		{
+			if (!descriptors[i].revents)
+				continue;
+
+			if (!receiveQueries(connections[i - 1], parameters.maxQueryLength, queries))
+			{
+				queries.end(connections[i - 1]);
+				descriptors.erase(descriptors.begin() + i);
+				connections.erase(connections.begin() + (i - 1));
+			}
+		}
+
+		if (!descriptors[0].revents)
+			continue;
+
+		int connection = accept(listener, nullptr, nullptr);
+		if (connection < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+
+			std::cerr << "Cannot accept connection: " << strerror(errno) << std::endl;
+			break;
+		}
+
+		pollfd descriptor;
+		descriptor.fd = connection;
+		descriptor.events = POLLIN;
+		descriptor.revents = 0;
+		descriptors.push_back(descriptor);
+		connections.push_back(std::make_shared<Connection>(connection));
+	}
+
+	close(listener);
+	removeSocketFile(parameters.socketPath);
+
+	queries.stop();
+	for (auto &worker : workers)
+		worker.join();
+
+	for (auto &connection : connections)
+		close(connection->socket);
+
+	return false;
+}
+#endif
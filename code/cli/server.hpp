@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <architect/QueryIndex.hpp>
+
+struct ServerParameters
+{
+	ServerParameters();
+
+	std::string socketPath;
+	uint32_t threadCount; // 0 for hardware concurrency
+	size_t maxQueryLength; // bytes, longer lines close the connection
+};
+
+// Answers one JSON query, e.g. {"query": "path", "from": "A", "to": "B"}.
+std::string answerQuery(const architect::QueryIndex &index, const std::string &query);
+
+#ifndef _WIN32
+// Listens on a Unix domain socket, answering each line received with one line. Only returns on error.
+bool serve(const architect::QueryIndex &index, const ServerParameters &parameters);
+#endif
@@ -0,0 +1,80 @@
+#include <architect/Allocation.hpp>
+
+#include <atomic>
+#include <string>
+#include <architect/Stats.hpp>
+
+namespace architect
+{
+	namespace
+	{
+		struct AtomicCounters
+		{
+			std::atomic<uint64_t> count;
+			std::atomic<uint64_t> bytes;
+			std::atomic<uint64_t> liveBytes;
+		};
+
+		// zero-initialized as a static
+		AtomicCounters counters[(size_t)AllocationCategory::COUNT];
+	}
+
+	void recordAllocation(AllocationCategory category, size_t size)
+	{
+		auto &categoryCounters = counters[(size_t)category];
+		categoryCounters.count.fetch_add(1, std::memory_order_relaxed);
+		categoryCounters.bytes.fetch_add(size, std::memory_order_relaxed);
+		categoryCounters.liveBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void recordDeallocation(AllocationCategory category, size_t size)
+	{
+		counters[(size_t)category].liveBytes.fetch_sub(size, std::memory_order_relaxed);
+	}
+
+	AllocationCounters getAllocationCounters(AllocationCategory category)
+	{
+		auto &categoryCounters = counters[(size_t)category];
+
+		AllocationCounters result;
+		result.count = categoryCounters.count.load(std::memory_order_relaxed);
+		result.bytes = categoryCounters.bytes.load(std::memory_order_relaxed);
+		result.liveBytes = categoryCounters.liveBytes.load(std::memory_order_relaxed);
+		return result;
+	}
+
+	const char *getAllocationCategoryName(AllocationCategory category)
+	{
+		switch (category)
+		{
+		case AllocationCategory::NAMESPACE:
+			return "namespace";
+		case AllocationCategory::SYMBOL:
+			return "symbol";
+		case AllocationCategory::REFERENCE:
+			return "reference";
+		case AllocationCategory::STRING_POOL:
+			return "stringPool";
+		case AllocationCategory::CLANG_STRING:
+			return "clangString";
+		default:
+			return "???";
+		}
+	}
+
+	void addAllocationCounters(Stats &stats)
+	{
+		Stats::Counters statsCounters;
+		for (size_t i = 0; i < (size_t)AllocationCategory::COUNT; ++i)
+		{
+			auto category = (AllocationCategory)i;
+			auto categoryCounters = getAllocationCounters(category);
+
+			std::string prefix = std::string("allocations.") + getAllocationCategoryName(category);
+			statsCounters[prefix + ".count"] = categoryCounters.count;
+			statsCounters[prefix + ".bytes"] = categoryCounters.bytes;
+			statsCounters[prefix + ".liveBytes"] = categoryCounters.liveBytes;
+		}
+		stats.addCounters(statsCounters);
+	}
+}
@@ -0,0 +1,13 @@
+#include <architect/Diff.hpp>
+
+namespace architect
+{
+	bool Diff::empty() const
+	{
+		return addedSymbols.empty() &&
+			removedSymbols.empty() &&
+			addedEdges.empty() &&
+			removedEdges.empty() &&
+			changedEdges.empty();
+	}
+}
@@ -0,0 +1,113 @@
+#include <architect/Fingerprint.hpp>
+
+namespace architect
+{
+	namespace
+	{
+		// high half is FNV-1a, low half is a multiply-rotate hash, so that both halves are independent
+		const uint64_t fnvPrime = 0x100000001b3ULL;
+		const uint64_t fnvOffsetBasis = 0xcbf29ce484222325ULL;
+		const uint64_t goldenRatio = 0x9e3779b97f4a7c15ULL;
+
+		// splitmix64 finalizer, spreads FNV's weak high bits
+		uint64_t mix(uint64_t value)
+		{
+			value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+			return value ^ (value >> 31);
+		}
+
+		const char hexDigits[] = "0123456789abcdef";
+	}
+
+	Fingerprint::Fingerprint()
+		: high(0)
+		, low(0)
+	{}
+
+	Fingerprint &Fingerprint::operator+=(const Fingerprint &other)
+	{
+		uint64_t previousLow = low;
+		low += other.low;
+		high += other.high + (low < previousLow ? 1 : 0);
+		return *this;
+	}
+
+	Fingerprint &Fingerprint::operator-=(const Fingerprint &other)
+	{
+		uint64_t previousLow = low;
+		low -= other.low;
+		high -= other.high + (low > previousLow ? 1 : 0);
+		return *this;
+	}
+
+	bool Fingerprint::operator==(const Fingerprint &other) const
+	{
+		return high == other.high && low == other.low;
+	}
+
+	bool Fingerprint::operator!=(const Fingerprint &other) const
+	{
+		return !(*this == other);
+	}
+
+	bool Fingerprint::operator<(const Fingerprint &other) const
+	{
+		if (high != other.high)
+			return high < other.high;
+		return low < other.low;
+	}
+
+	std::string Fingerprint::toString() const
+	{
+		std::string str(32, '0');
+		for (int i = 0; i < 16; ++i)
+		{
+			str[15 - i] = hexDigits[(high >> (i * 4)) & 0xf];
+			str[31 - i] = hexDigits[(low >> (i * 4)) & 0xf];
+		}
+		return str;
+	}
+
+	FingerprintBuilder::FingerprintBuilder()
+		: _high(fnvOffsetBasis)
+		, _low(goldenRatio)
+	{}
+
+	FingerprintBuilder &FingerprintBuilder::add(const std::string &value)
+	{
+		add((uint64_t)value.size());
+		for (char c : value)
+			addByte((uint8_t)c);
+		return *this;
+	}
+
+	FingerprintBuilder &FingerprintBuilder::add(uint64_t value)
+	{
+		for (int i = 0; i < 8; ++i)
+			addByte((uint8_t)(value >> (i * 8)));
+		return *this;
+	}
+
+	FingerprintBuilder &FingerprintBuilder::add(const Fingerprint &value)
+	{
+		add(value.high);
+		add(value.low);
+		return *this;
+	}
+
+	Fingerprint FingerprintBuilder::get() const
+	{
+		Fingerprint fingerprint;
+		fingerprint.high = mix(_high);
+		fingerprint.low = mix(_low ^ _high);
+		return fingerprint;
+	}
+
+	void FingerprintBuilder::addByte(uint8_t byte)
+	{
+		_high = (_high ^ byte) * fnvPrime;
+		_low = (_low ^ byte) * goldenRatio;
+		_low = (_low << 23) | (_low >> 41);
+	}
+}
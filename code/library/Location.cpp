@@ -1,5 +1,7 @@
 #include <architect/Location.hpp>
 
+#include <architect/ClangString.hpp>
+
 namespace architect
 {
 #ifdef ARCHITECT_CLANG_SUPPORT
@@ -8,7 +10,7 @@ namespace architect
 		CXString cfilename;
 		CXSourceLocation sourceLocation = clang_getCursorLocation(cursor);
 		clang_getPresumedLocation(sourceLocation, &cfilename, &line, &column);
-		filename = clang_getCString(cfilename);
+		filename = ClangString(cfilename).str();
 	}
 #endif
 
@@ -0,0 +1,120 @@
+#include <architect/QueryIndex.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+
+namespace architect
+{
+	QueryIndex::QueryIndex(const Registry &registry)
+		: _registry(registry)
+		, _reverseReferences(registry.computeReverseReferences())
+	{
+		ComputeCyclesParameters parameters;
+		parameters.minCardinality = 1;
+		for (auto &cycle : registry.computeScc(parameters))
+		{
+			for (auto symbol : cycle)
+				_symbolCycles.insert(std::make_pair(symbol->id, _cycles.size()));
+			_cycles.push_back(std::vector<const Symbol *>(cycle.begin(), cycle.end()));
+		}
+
+		for (auto &pair : registry.getSymbols())
+		{
+			std::string previousFilename;
+			for (auto &refPair : pair.second->references)
+			{
+				for (auto &reference : refPair.second)
+				{
+					auto &filename = reference.location.filename;
+					if (filename == previousFilename)
+						continue;
+
+					auto &fileSymbols = _fileSymbols[filename];
+					if (fileSymbols.empty() || fileSymbols.back() != pair.second)
+						fileSymbols.push_back(pair.second);
+					previousFilename = filename;
+				}
+			}
+		}
+	}
+
+	const Registry &QueryIndex::getRegistry() const
+	{
+		return _registry;
+	}
+
+	Symbols QueryIndex::findSymbols(const std::string &name) const
+	{
+		return _registry.findSymbols(name);
+	}
+
+	Symbols QueryIndex::computeNeighborhood(const Symbols &focus, const ComputeNeighborhoodParameters &parameters) const
+	{
+		Symbols neighborhood = _registry.computeNeighborhood(focus, parameters, &_reverseReferences);
+		for (auto &pair : focus)
+			neighborhood.erase(pair.first);
+		return neighborhood;
+	}
+
+	const std::vector<const Symbol *> &QueryIndex::getCycle(const Symbol *symbol) const
+	{
+		static const std::vector<const Symbol *> noCycle;
+
+		auto it = _symbolCycles.find(symbol->id);
+		if (it == _symbolCycles.end())
+			return noCycle;
+		return _cycles[it->second];
+	}
+
+	std::vector<const Symbol *> QueryIndex::findPath(const Symbol *from, const Symbol *to) const
+	{
+		auto &symbols = _registry.getSymbols();
+
+		std::unordered_map<SymbolId, const Symbol *> predecessors;
+		std::deque<const Symbol *> queue;
+
+		predecessors.insert(std::make_pair(from->id, nullptr));
+		queue.push_back(from);
+
+		while (!queue.empty())
+		{
+			const Symbol *symbol = queue.front();
+			queue.pop_front();
+
+			if (symbol == to)
+			{
+				std::vector<const Symbol *> path;
+				for (; symbol; symbol = predecessors.at(symbol->id))
+					path.push_back(symbol);
+				std::reverse(path.begin(), path.end());
+				return path;
+			}
+
+			for (auto &refPair : symbol->references)
+			{
+				auto it = symbols.find(refPair.first);
+				if (it != symbols.end() && predecessors.insert(std::make_pair(refPair.first, symbol)).second)
+					queue.push_back(it->second);
+			}
+		}
+
+		return std::vector<const Symbol *>();
+	}
+
+	Symbols QueryIndex::computeFileImpact(const std::string &filename) const
+	{
+		auto it = _fileSymbols.find(filename);
+		if (it == _fileSymbols.end())
+			return Symbols();
+
+		Symbols focus;
+		for (auto symbol : it->second)
+			focus.insert(std::make_pair(symbol->id, symbol));
+
+		ComputeNeighborhoodParameters parameters;
+		parameters.radius = std::numeric_limits<uint32_t>::max();
+		parameters.direction = NeighborhoodDirection::IN;
+		return _registry.computeNeighborhood(focus, parameters, &_reverseReferences);
+	}
+}
@@ -1,7 +1,11 @@
 #include <architect/Registry.hpp>
 
 #include <algorithm>
+#include <functional>
+#include <iterator>
 #include <stack>
+#include <unordered_map>
+#include <unordered_set>
 #include <architect/Symbol.hpp>
 
 namespace architect
@@ -85,6 +89,149 @@ namespace architect
 
 			return data.lowlink;
 		}
+
+		typedef std::unordered_map<SymbolId, Fingerprint> Identities;
+		typedef std::map<Fingerprint, std::vector<const Symbol *>> IdentityMap;
+		typedef std::vector<std::pair<Fingerprint, const ReferenceSet *>> IdentifiedReferences;
+
+		Fingerprint computeSymbolFingerprint(const Symbol *symbol, const Identities &identities)
+		{
+			Fingerprint references;
+			for (auto &pair : symbol->references)
+			{
+				auto &target = identities.at(pair.first);
+				for (auto &reference : pair.second)
+				{
+					FingerprintBuilder builder;
+					builder.add(target);
+					builder.add((uint64_t)reference.type);
+					// not the filename, which equality ignores when either is empty
+					builder.add((uint64_t)reference.location.line);
+					builder.add((uint64_t)reference.location.column);
+					references += builder.get();
+				}
+			}
+
+			FingerprintBuilder builder;
+			builder.add(identities.at(symbol->id));
+			builder.add((uint64_t)symbol->defined);
+			builder.add(references);
+			return builder.get();
+		}
+
+		void identifyReferences(const Symbol *symbol, const Identities &identities, IdentifiedReferences &references)
+		{
+			for (auto &pair : symbol->references)
+				references.push_back(std::make_pair(identities.at(pair.first), &pair.second));
+
+			std::sort(references.begin(), references.end(), [](const IdentifiedReferences::value_type &a, const IdentifiedReferences::value_type &b)
+			{
+				if (a.first != b.first)
+					return a.first < b.first;
+				return *a.second < *b.second;
+			});
+		}
+
+		bool areSymbolsEqual(const Symbol *symbol, const Identities &identities, const Symbol *otherSymbol, const Identities &otherIdentities)
+		{
+			if (symbol->type != otherSymbol->type)
+				return false;
+			if (symbol->defined != otherSymbol->defined)
+				return false;
+
+			// registries have their own string pools
+			if (symbol->getName() != otherSymbol->getName())
+				return false;
+			if (symbol->getTypeName() != otherSymbol->getTypeName())
+				return false;
+
+			if (symbol->templateParameters != otherSymbol->templateParameters)
+				return false;
+
+			const Namespace *iterNs = symbol->ns;
+			const Namespace *iterOtherNs = otherSymbol->ns;
+			for (;;)
+			{
+				if (!iterNs->parent || !iterOtherNs->parent)
+				{
+					if (iterNs->parent || iterOtherNs->parent)
+						return false;
+					break;
+				}
+
+				if (iterNs->getName() != iterOtherNs->getName())
+					return false;
+
+				iterNs = iterNs->parent;
+				iterOtherNs = iterOtherNs->parent;
+			}
+
+			if (symbol->references.size() != otherSymbol->references.size())
+				return false;
+
+			IdentifiedReferences references, otherReferences;
+			identifyReferences(symbol, identities, references);
+			identifyReferences(otherSymbol, otherIdentities, otherReferences);
+
+			for (auto itReferenceItem = references.begin(), itOtherReferenceItem = otherReferences.begin();
+				itReferenceItem != references.end();
+				++itReferenceItem, ++itOtherReferenceItem)
+			{
+				if (itReferenceItem->first != itOtherReferenceItem->first)
+					return false;
+
+				auto &referenceSet = *itReferenceItem->second;
+				auto &otherReferenceSet = *itOtherReferenceItem->second;
+
+				if (referenceSet.size() != otherReferenceSet.size())
+					return false;
+
+				for (auto itReference = referenceSet.begin(), itOtherReference = otherReferenceSet.begin();
+					itReference != referenceSet.end();
+					++itReference, ++itOtherReference)
+				{
+					const Reference &reference = *itReference;
+					const Reference &otherReference = *itOtherReference;
+
+					if (reference.type != otherReference.type)
+						return false;
+					if (!reference.location.filename.empty() &&
+						!otherReference.location.filename.empty() &&
+						reference.location.filename != otherReference.location.filename)
+						return false;
+					if (reference.location.line != otherReference.location.line)
+						return false;
+					if (reference.location.column != otherReference.location.column)
+						return false;
+				}
+			}
+
+			return true;
+		}
+
+		// distinct types, most important first
+		std::vector<ReferenceType> getReferenceTypes(const ReferenceSet &references)
+		{
+			std::vector<ReferenceType> types;
+			for (auto &reference : references)
+			{
+				if (types.empty() || types.back() != reference.type)
+					types.push_back(reference.type);
+			}
+			return types;
+		}
+
+		void addDiffEdges(const Symbol *from, const Symbol *to, const ReferenceSet &references, std::vector<DiffEdge> &edges)
+		{
+			for (auto type : getReferenceTypes(references))
+			{
+				DiffEdge edge;
+				edge.from = from;
+				edge.to = to;
+				edge.type = type;
+				edges.push_back(edge);
+			}
+		}
 	}
 
 	Registry::Registry()
@@ -107,15 +254,65 @@ namespace architect
 			delete pair.second;
 		_symbols.clear();
 		
+		strings.clear();
+
 		rootNameSpace = Namespace();
 		rootNameSpace.parent = nullptr;
+		rootNameSpace.strings = &strings;
+		rootNameSpace.name = StringPool::empty;
 		
 		_nextSymbolId = 0;
 	}
 
-	Namespace *Registry::createNamespace()
+	void Registry::copy(const Registry &other)
+	{
+		clear();
+
+		strings.copy(other.strings);
+
+		std::unordered_map<const Namespace *, Namespace *> namespaces;
+		namespaces.insert(std::make_pair(&other.rootNameSpace, &rootNameSpace));
+		for (auto otherNs : other._namespaces)
+		{
+			auto ns = new Namespace(*otherNs);
+			ns->strings = &strings;
+			_namespaces.insert(ns);
+			namespaces.insert(std::make_pair(otherNs, ns));
+		}
+
+		for (auto &pair : other._symbols)
+		{
+			auto symbol = new Symbol(*pair.second);
+			symbol->ns = namespaces.at(symbol->ns);
+			_symbols.insert(std::make_pair(pair.first, symbol));
+		}
+
+		// pointers to the other registry are replaced
+		auto relink = [&](Namespace *ns, const Namespace *otherNs)
+		{
+			ns->parent = otherNs->parent ? namespaces.at(otherNs->parent) : nullptr;
+			for (auto &pair : ns->children)
+				pair.second = namespaces.at(pair.second);
+			for (auto &pair : ns->symbols)
+				pair.second = _symbols.at(pair.second->id);
+		};
+
+		rootNameSpace.children = other.rootNameSpace.children;
+		rootNameSpace.symbols = other.rootNameSpace.symbols;
+		for (auto &pair : namespaces)
+			relink(pair.second, pair.first);
+
+		_nextSymbolId = other._nextSymbolId.load();
+	}
+
+	Namespace *Registry::createNamespace(Namespace *parent, StringId name)
 	{
 		auto ns = new Namespace();
+		ns->parent = parent;
+		ns->strings = &strings;
+		ns->name = name;
+		ns->computeQualifiedName();
+		std::lock_guard<std::mutex> lock(_namespacesMutex);
 		_namespaces.insert(ns);
 		return ns;
 	}
@@ -123,19 +320,188 @@ namespace architect
 	Symbol *Registry::createSymbol(SymbolType type, bool defined)
 	{
 		auto symbol = new Symbol();
-		symbol->id = _nextSymbolId;
+		symbol->id = _nextSymbolId++;
 		symbol->type = type;
 		symbol->defined = defined;
-		_symbols.insert(std::pair<SymbolId, Symbol *>(_nextSymbolId, symbol));
-		++_nextSymbolId;
+		std::lock_guard<std::mutex> lock(_symbolsMutex);
+		_symbols.insert(std::pair<SymbolId, Symbol *>(symbol->id, symbol));
+		return symbol;
+	}
+
+	Namespace *Registry::findNamespace(const Namespace *parent, StringId name) const
+	{
+		std::lock_guard<std::mutex> lock(getMutex(parent));
+		auto it = parent->children.find(name);
+		if (it == parent->children.end())
+			return nullptr;
+		return it->second;
+	}
+
+	Namespace *Registry::getOrCreateNamespace(Namespace *parent, StringId name)
+	{
+		std::lock_guard<std::mutex> lock(getMutex(parent));
+		auto it = parent->children.find(name);
+		if (it != parent->children.end())
+			return it->second;
+
+		auto ns = createNamespace(parent, name);
+		parent->children.insert(std::pair<StringId, Namespace *>(name, ns));
+		return ns;
+	}
+
+	Symbol *Registry::findSymbol(const Namespace *ns, const SymbolIdentifier &identifier) const
+	{
+		std::lock_guard<std::mutex> lock(getMutex(ns));
+		auto it = ns->symbols.find(identifier);
+		if (it == ns->symbols.end())
+			return nullptr;
+		return it->second;
+	}
+
+	Symbol *Registry::getOrCreateSymbol(Namespace *ns, const SymbolIdentifier &identifier, SymbolType type, bool *created)
+	{
+		std::lock_guard<std::mutex> lock(getMutex(ns));
+		auto it = ns->symbols.find(identifier);
+		if (created)
+			*created = it == ns->symbols.end();
+		if (it != ns->symbols.end())
+			return it->second;
+
+		auto symbol = createSymbol(type, false);
+		symbol->identifier = identifier;
+		symbol->ns = ns;
+		ns->symbols.insert(std::pair<SymbolIdentifier, Symbol *>(identifier, symbol));
 		return symbol;
 	}
 
+	std::mutex &Registry::getMutex(const void *object) const
+	{
+		return _mutexes[std::hash<const void *>()(object) % mutexCount];
+	}
+
 	const Symbols &Registry::getSymbols() const
 	{
 		return _symbols;
 	}
 
+	Symbols Registry::findSymbols(const std::string &name) const
+	{
+		Symbols symbols;
+
+		// anonymous namespaces and symbols are written "?"
+		auto findComponent = [this](const std::string &component, StringId &id)
+		{
+			if (component == "?")
+			{
+				id = StringPool::empty;
+				return true;
+			}
+			return strings.find(component, id);
+		};
+
+		const Namespace *ns = &rootNameSpace;
+		size_t begin = 0;
+		for (size_t end = name.find("::"); ns && end != std::string::npos; end = name.find("::", begin))
+		{
+			StringId id;
+			ns = findComponent(name.substr(begin, end - begin), id) ? findNamespace(ns, id) : nullptr;
+			begin = end + 2;
+		}
+
+		StringId id;
+		if (ns && findComponent(name.substr(begin), id))
+		{
+			for (auto &pair : ns->symbols)
+			{
+				if (pair.first.name == id)
+					symbols.insert(std::make_pair(pair.second->id, pair.second));
+			}
+		}
+
+		// the full name disambiguates overloads and template specializations
+		if (symbols.empty())
+		{
+			std::string fullName;
+			for (auto &pair : _symbols)
+			{
+				fullName.clear();
+				pair.second->appendFullName(fullName);
+				if (fullName == name)
+					symbols.insert(pair);
+			}
+		}
+
+		return symbols;
+	}
+
+	ReverseReferences Registry::computeReverseReferences() const
+	{
+		ReverseReferences reverseReferences;
+		for (auto &pair : _symbols)
+		{
+			for (auto &refPair : pair.second->references)
+				reverseReferences[refPair.first].push_back(pair.second);
+		}
+		return reverseReferences;
+	}
+
+	Symbols Registry::computeNeighborhood(const Symbols &focus, const ComputeNeighborhoodParameters &parameters, const ReverseReferences *reverseReferences) const
+	{
+		bool forward = parameters.direction != NeighborhoodDirection::IN;
+		bool backward = parameters.direction != NeighborhoodDirection::OUT;
+
+		ReverseReferences computedReverseReferences;
+		if (backward && !reverseReferences)
+		{
+			computedReverseReferences = computeReverseReferences();
+			reverseReferences = &computedReverseReferences;
+		}
+
+		Symbols neighborhood(focus);
+		std::vector<const Symbol *> frontier;
+		std::vector<const Symbol *> nextFrontier;
+
+		for (auto &pair : focus)
+			frontier.push_back(pair.second);
+
+		auto visit = [&](SymbolId id, Symbol *symbol)
+		{
+			if (neighborhood.insert(std::make_pair(id, symbol)).second)
+				nextFrontier.push_back(symbol);
+		};
+
+		for (uint32_t distance = 0; distance < parameters.radius && !frontier.empty(); ++distance)
+		{
+			for (auto symbol : frontier)
+			{
+				if (forward)
+				{
+					for (auto &refPair : symbol->references)
+					{
+						auto it = _symbols.find(refPair.first);
+						if (it != _symbols.end())
+							visit(it->first, it->second);
+					}
+				}
+
+				if (backward)
+				{
+					auto it = reverseReferences->find(symbol->id);
+					if (it != reverseReferences->end())
+					{
+						for (auto referencingSymbol : it->second)
+							visit(referencingSymbol->id, referencingSymbol);
+					}
+				}
+			}
+
+			frontier.swap(nextFrontier);
+			nextFrontier.clear();
+		}
+
+		return neighborhood;
+	}
+
 	void Registry::removeRedundantDependencies()
 	{
 		// Root -> A, C
@@ -143,51 +509,94 @@ namespace architect
 		// B -> C
 		// then remove Root -> C
 
+		// an edge to a symbol on a cycle may be the only way to reach it, even if the symbol reaches itself
+		ComputeCyclesParameters sccParameters;
+		sccParameters.minCardinality = 1;
+		std::unordered_set<SymbolId> cyclicIds;
+		for (auto &scc : computeScc(sccParameters))
+		{
+			for (auto symbol : scc)
+				cyclicIds.insert(symbol->id);
+		}
 		for (auto &pair : _symbols)
 		{
-			std::list<SymbolId> references;
-
-			auto &symbolRoot = pair.second;
-			auto &dependenciesRoot = symbolRoot->references;
+			if (pair.second->references.count(pair.first))
+				cyclicIds.insert(pair.first);
+		}
 
-			for (auto &dependency : dependenciesRoot)
+		// each reachable symbol once, enumerating paths is exponential and never ends with cycles
+		// paths through the root would use its own edges, so the root is never visited
+		auto isReachable = [this](SymbolId rootId, const std::vector<SymbolId> &startIds, SymbolId targetId, std::unordered_set<SymbolId> *reachedIds)
+		{
+			std::unordered_set<SymbolId> localReachedIds;
+			std::unordered_set<SymbolId> &visitedIds = reachedIds ? *reachedIds : localReachedIds;
+			std::vector<SymbolId> references;
+			for (auto id : startIds)
 			{
-				references.push_back(dependency.first);
+				for (auto &dependency : _symbols[id]->references)
+				{
+					if (dependency.first != rootId && visitedIds.insert(dependency.first).second)
+						references.push_back(dependency.first);
+				}
 			}
 
-			for (auto &dependency : references)
+			for (size_t i = 0; i < references.size(); ++i)
 			{
-				auto &subSymbol = _symbols[dependency];
-				for (auto &subDependency : subSymbol->references)
+				if (references[i] == targetId)
+					return true;
+
+				for (auto &dependency : _symbols[references[i]]->references)
 				{
-					references.push_back(subDependency.first);
+					if (dependency.first != rootId && visitedIds.insert(dependency.first).second)
+						references.push_back(dependency.first);
 				}
 			}
+			return visitedIds.count(targetId) != 0;
+		};
+
+		for (auto &pair : _symbols)
+		{
+			auto rootId = pair.first;
+			auto &dependenciesRoot = pair.second->references;
+
+			std::vector<SymbolId> successorIds;
+			for (auto &dependency : dependenciesRoot)
+			{
+				if (dependency.first != rootId)
+					successorIds.push_back(dependency.first);
+			}
+
+			// symbols reachable from the successors through at least one edge
+			std::unordered_set<SymbolId> reachedIds;
+			isReachable(rootId, successorIds, rootId, &reachedIds);
 
-			for (auto &a : references)
+			for (auto id : successorIds)
 			{
-				auto &symbolA = _symbols[a];
-				auto &dependenciesA = symbolA->references;
+				if (!reachedIds.count(id))
+					continue;
 
-				auto itB = dependenciesRoot.begin();
-				while (itB != dependenciesRoot.end())
+				if (cyclicIds.count(id))
 				{
-					auto &symbolB = itB->first;
-					if (dependenciesA.find(symbolB) != dependenciesA.end())
-					{
-						itB = dependenciesRoot.erase(itB);
-					}
-					else
+					// reached from another remaining successor, not only from itself
+					std::vector<SymbolId> otherIds;
+					for (auto &dependency : dependenciesRoot)
 					{
-						++itB;
+						if (dependency.first != rootId && dependency.first != id)
+							otherIds.push_back(dependency.first);
 					}
+					if (!isReachable(rootId, otherIds, id, nullptr))
+						continue;
 				}
+
+				dependenciesRoot.erase(id);
 			}
 		}
 	}
 
 	Cycles Registry::computeCycles(const ComputeCyclesParameters &parameters) const
 	{
+		ScopedTimer timer(parameters.stats, "cycles");
+
 		Cycles cycles;
 		std::set<const Symbol *> visitedSymbols;
 
@@ -248,6 +657,8 @@ namespace architect
 	{
 		// https://en.wikipedia.org/wiki/Tarjan%27s_strongly_connected_components_algorithm
 
+		ScopedTimer timer(parameters.stats, "scc");
+
 		SccContext context(parameters, _symbols);
 
 		for (auto &pair : _symbols)
@@ -263,87 +674,261 @@ namespace architect
 		return context.cluters;
 	}
 
-	bool Registry::operator==(const Registry &other) const
+	Fingerprint Registry::computeFingerprint() const
 	{
-		if (_symbols.size() != other._symbols.size())
-			return false;
+		Identities identities;
+		identities.reserve(_symbols.size());
+		for (auto &pair : _symbols)
+			identities.insert(std::make_pair(pair.first, pair.second->computeIdentityFingerprint()));
+
+		Fingerprint fingerprint;
+		for (auto &pair : _symbols)
+			fingerprint += computeSymbolFingerprint(pair.second, identities);
+		return fingerprint;
+	}
+
+	Fingerprint Registry::computeFingerprint(const Symbol *symbol) const
+	{
+		Identities identities;
+		identities.insert(std::make_pair(symbol->id, symbol->computeIdentityFingerprint()));
+		for (auto &pair : symbol->references)
+			identities.insert(std::make_pair(pair.first, _symbols.at(pair.first)->computeIdentityFingerprint()));
+
+		return computeSymbolFingerprint(symbol, identities);
+	}
 
-		for (auto itSymbol = _symbols.begin(), itOtherSymbol = other._symbols.begin();
-			itSymbol != _symbols.end();
-			++itSymbol, ++itOtherSymbol)
+	Diff Registry::computeDiff(const Registry &previous) const
+	{
+		Diff diff;
+
+		// symbols sharing an identity are matched in id order
+		std::unordered_map<Fingerprint, std::vector<const Symbol *>> previousSymbols;
+		previousSymbols.reserve(previous._symbols.size());
+		for (auto &pair : previous._symbols)
+			previousSymbols[pair.second->computeIdentityFingerprint()].push_back(pair.second);
+
+		std::unordered_map<Fingerprint, size_t> matchCounts;
+		std::unordered_map<const Symbol *, const Symbol *> matches; // previous to current
+		for (auto &pair : _symbols)
 		{
-			const Symbol *symbol = itSymbol->second;
-			const Symbol *otherSymbol = itOtherSymbol->second;
+			auto identity = pair.second->computeIdentityFingerprint();
 
-			if (symbol->type != otherSymbol->type)
-				return false;
-			if (symbol->defined != otherSymbol->defined)
-				return false;
+			auto it = previousSymbols.find(identity);
+			size_t &matchCount = matchCounts[identity];
+			if (it != previousSymbols.end() && matchCount < it->second.size())
+			{
+				matches.insert(std::make_pair(it->second[matchCount], pair.second));
+				++matchCount;
+			}
+			else
+				diff.addedSymbols.push_back(pair.second);
+		}
 
-			if (symbol->identifier.name != otherSymbol->identifier.name)
-				return false;
-			if (symbol->identifier.type != otherSymbol->identifier.type)
-				return false;
-			
-			if (symbol->templateParameters.size() != otherSymbol->templateParameters.size())
-				return false;
+		// an edge is a reference type from a symbol to another
+		for (auto symbol : diff.addedSymbols)
+		{
+			for (auto &refPair : symbol->references)
+				addDiffEdges(symbol, _symbols.at(refPair.first), refPair.second, diff.addedEdges);
+		}
 
-			for (auto itTemplateParameterItem = symbol->templateParameters.begin(), itOtherTemplateParameterItem = otherSymbol->templateParameters.begin();
-			itTemplateParameterItem != symbol->templateParameters.end();
-				++itTemplateParameterItem, ++itOtherTemplateParameterItem)
+		auto getCurrent = [&](const Symbol *previousSymbol)
+		{
+			auto it = matches.find(previousSymbol);
+			return it == matches.end() ? previousSymbol : it->second;
+		};
+
+		for (auto &pair : previous._symbols)
+		{
+			const Symbol *previousSymbol = pair.second;
+			auto itMatch = matches.find(previousSymbol);
+			if (itMatch == matches.end())
 			{
-				if (*itTemplateParameterItem != *itOtherTemplateParameterItem)
-					return false;
+				diff.removedSymbols.push_back(previousSymbol);
+
+				for (auto &refPair : previousSymbol->references)
+					addDiffEdges(previousSymbol, getCurrent(previous._symbols.at(refPair.first)), refPair.second, diff.removedEdges);
+				continue;
 			}
 
-			const Namespace *iterNs = symbol->ns;
-			const Namespace *iterOtherNs = otherSymbol->ns;
-			for (;;)
+			const Symbol *symbol = itMatch->second;
+
+			// keyed by the current target, removed targets stay in the previous registry
+			std::unordered_map<const Symbol *, const ReferenceSet *> previousReferences;
+			for (auto &refPair : previousSymbol->references)
+				previousReferences.insert(std::make_pair(getCurrent(previous._symbols.at(refPair.first)), &refPair.second));
+
+			for (auto &refPair : symbol->references)
 			{
-				if (iterNs == &rootNameSpace && iterOtherNs == &other.rootNameSpace)
+				const Symbol *target = _symbols.at(refPair.first);
+
+				auto it = previousReferences.find(target);
+				if (it == previousReferences.end())
+				{
+					addDiffEdges(symbol, target, refPair.second, diff.addedEdges);
+					continue;
+				}
+
+				auto types = getReferenceTypes(refPair.second);
+				auto previousTypes = getReferenceTypes(*it->second);
+				previousReferences.erase(it);
+
+				std::vector<ReferenceType> addedTypes, removedTypes;
+				std::set_difference(types.begin(), types.end(), previousTypes.begin(), previousTypes.end(), std::back_inserter(addedTypes));
+				std::set_difference(previousTypes.begin(), previousTypes.end(), types.begin(), types.end(), std::back_inserter(removedTypes));
+
+				// a removed type replaced by an added one is a change, most important first
+				size_t changedCount = std::min(addedTypes.size(), removedTypes.size());
+				for (size_t i = 0; i < changedCount; ++i)
+				{
+					DiffChangedEdge edge;
+					edge.from = symbol;
+					edge.to = target;
+					edge.previousType = removedTypes[i];
+					edge.type = addedTypes[i];
+					diff.changedEdges.push_back(edge);
+				}
+
+				for (size_t i = changedCount; i < addedTypes.size(); ++i)
+				{
+					DiffEdge edge;
+					edge.from = symbol;
+					edge.to = target;
+					edge.type = addedTypes[i];
+					diff.addedEdges.push_back(edge);
+				}
+
+				for (size_t i = changedCount; i < removedTypes.size(); ++i)
+				{
+					DiffEdge edge;
+					edge.from = symbol;
+					edge.to = target;
+					edge.type = removedTypes[i];
+					diff.removedEdges.push_back(edge);
+				}
+			}
+
+			// remaining targets are removed, iterated in id order for a stable output
+			for (auto &refPair : previousSymbol->references)
+			{
+				if (previousReferences.empty())
 					break;
 
-				if (iterNs->name != iterOtherNs->name)
-					return false;
+				const Symbol *target = getCurrent(previous._symbols.at(refPair.first));
+				auto it = previousReferences.find(target);
+				if (it == previousReferences.end())
+					continue;
 
-				iterNs = iterNs->parent;
-				iterOtherNs = iterOtherNs->parent;
+				addDiffEdges(symbol, target, *it->second, diff.removedEdges);
+				previousReferences.erase(it);
 			}
+		}
 
-			if (symbol->references.size() != otherSymbol->references.size())
+		return diff;
+	}
+
+	bool Registry::operator==(const Registry &other) const
+	{
+		if (_symbols.size() != other._symbols.size())
+			return false;
+
+		Identities identities, otherIdentities;
+		IdentityMap otherSymbols;
+		for (auto &pair : _symbols)
+			identities.insert(std::make_pair(pair.first, pair.second->computeIdentityFingerprint()));
+		for (auto &pair : other._symbols)
+		{
+			auto identity = pair.second->computeIdentityFingerprint();
+			otherIdentities.insert(std::make_pair(pair.first, identity));
+			otherSymbols[identity].push_back(pair.second);
+		}
+
+		for (auto &pair : _symbols)
+		{
+			const Symbol *symbol = pair.second;
+
+			auto it = otherSymbols.find(identities.at(symbol->id));
+			if (it == otherSymbols.end())
 				return false;
 
-			for (auto itReferenceItem = symbol->references.begin(), itOtherReferenceItem = otherSymbol->references.begin();
-				itReferenceItem != symbol->references.end();
-				++itReferenceItem, ++itOtherReferenceItem)
+			// symbols sharing an identity are matched to the first equal one
+			auto &candidates = it->second;
+			auto itCandidate = candidates.begin();
+			while (itCandidate != candidates.end())
 			{
-				if (itReferenceItem->first != itOtherReferenceItem->first)
-					return false;
+				if (areSymbolsEqual(symbol, identities, *itCandidate, otherIdentities))
+					break;
+				++itCandidate;
+			}
 
-				if (itReferenceItem->second.size() != itOtherReferenceItem->second.size())
-					return false;
+			if (itCandidate == candidates.end())
+				return false;
 
-				for (auto itReference = itReferenceItem->second.begin(), itOtherReference = itOtherReferenceItem->second.begin();
-				itReference != itReferenceItem->second.end();
-					++itReference, ++itOtherReference)
-				{
-					const Reference &reference = *itReference;
-					const Reference &otherReference = *itOtherReference;
+			candidates.erase(itCandidate);
+		}
 
-					if (reference.type != otherReference.type)
-						return false;
-					if (!reference.location.filename.empty() &&
-						!otherReference.location.filename.empty() &&
-						reference.location.filename != otherReference.location.filename)
-						return false;
-					if (reference.location.line != otherReference.location.line)
-						return false;
-					if (reference.location.column != otherReference.location.column)
-						return false;
-				}
+		return true;
+	}
+
+	ReferenceBuffer::ReferenceBuffer(Registry &registry, size_t capacity, Stats *stats)
+		: _registry(registry)
+		, _capacity(capacity)
+		, _stats(stats)
+	{
+		_references.reserve(capacity);
+	}
+
+	ReferenceBuffer::~ReferenceBuffer()
+	{
+		flush();
+	}
+
+	void ReferenceBuffer::insert(Symbol *symbol, SymbolId id, const Reference &reference)
+	{
+		PendingReference pending;
+		pending.symbol = symbol;
+		pending.id = id;
+		pending.reference = reference;
+		_references.push_back(pending);
+
+		if (_references.size() >= _capacity)
+			flush();
+	}
+
+	void ReferenceBuffer::flush()
+	{
+		if (_references.empty())
+			return;
+
+		ScopedTimer timer(_stats, "merge");
+
+		// group by symbol so that each lock is taken once per symbol
+		std::stable_sort(_references.begin(), _references.end(), [](const PendingReference &a, const PendingReference &b)
+		{
+			return a.symbol < b.symbol;
+		});
+
+		uint64_t insertedCount = 0;
+		auto it = _references.begin();
+		while (it != _references.end())
+		{
+			Symbol *symbol = it->symbol;
+			std::lock_guard<std::mutex> lock(_registry.getMutex(symbol));
+			for (; it != _references.end() && it->symbol == symbol; ++it)
+			{
+				auto &referenceSet = symbol->references[it->id];
+				if (referenceSet.insert(it->reference).second)
+					++insertedCount;
 			}
 		}
 
-		return true;
+		if (_stats)
+		{
+			Stats::Counters counters;
+			counters["references.inserted"] = insertedCount;
+			counters["references.duplicates"] = _references.size() - insertedCount;
+			_stats->addCounters(counters);
+		}
+
+		_references.clear();
 	}
 }
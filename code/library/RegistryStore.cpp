@@ -0,0 +1,33 @@
+#include <architect/RegistryStore.hpp>
+
+namespace architect
+{
+	RegistryStore::RegistryStore()
+		: _snapshot(std::make_shared<const Registry>())
+	{}
+
+	RegistryStore::Snapshot RegistryStore::getSnapshot() const
+	{
+		return std::atomic_load(&_snapshot);
+	}
+
+	bool RegistryStore::update(const std::function<bool(Registry &)> &updater)
+	{
+		std::lock_guard<std::mutex> lock(_updateMutex);
+
+		std::shared_ptr<Registry> registry = std::make_shared<Registry>();
+		registry->copy(*std::atomic_load(&_snapshot));
+
+		if (!updater(*registry))
+			return false;
+
+		std::atomic_store(&_snapshot, Snapshot(std::move(registry)));
+		return true;
+	}
+
+	void RegistryStore::publish(std::unique_ptr<Registry> registry)
+	{
+		std::lock_guard<std::mutex> lock(_updateMutex);
+		std::atomic_store(&_snapshot, Snapshot(std::move(registry)));
+	}
+}
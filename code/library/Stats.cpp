@@ -0,0 +1,149 @@
+#include <architect/Stats.hpp>
+
+#include <algorithm>
+
+namespace architect
+{
+	Stats::Stats()
+		: _trace(nullptr)
+	{}
+
+	void Stats::setCallback(const Callback &callback)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_callback = callback;
+	}
+
+	void Stats::setTrace(Trace *trace)
+	{
+		_trace = trace;
+	}
+
+	Trace *Stats::getTrace() const
+	{
+		return _trace;
+	}
+
+	void Stats::addPhase(const std::string &name, Clock::duration duration)
+	{
+		Callback callback;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			// few phases, a linear search keeps their order
+			auto it = _phases.begin();
+			while (it != _phases.end() && it->name != name)
+				++it;
+
+			if (it == _phases.end())
+			{
+				Phase phase;
+				phase.name = name;
+				phase.duration = duration;
+				phase.count = 1;
+				_phases.push_back(phase);
+			}
+			else
+			{
+				it->duration += duration;
+				++it->count;
+			}
+
+			callback = _callback;
+		}
+
+		if (callback)
+			callback(name, duration);
+	}
+
+	void Stats::addCounter(const std::string &name, uint64_t value)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_counters[name] += value;
+	}
+
+	void Stats::addCounters(const Counters &counters)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto &pair : counters)
+			_counters[pair.first] += pair.second;
+	}
+
+	void Stats::addTranslationUnit(const TranslationUnit &translationUnit)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_translationUnits.push_back(translationUnit);
+	}
+
+	std::vector<Stats::Phase> Stats::getPhases() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _phases;
+	}
+
+	Stats::Counters Stats::getCounters() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _counters;
+	}
+
+	std::vector<Stats::TranslationUnit> Stats::getTranslationUnits() const
+	{
+		std::vector<TranslationUnit> translationUnits;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			translationUnits = _translationUnits;
+		}
+
+		std::stable_sort(translationUnits.begin(), translationUnits.end(), [](const TranslationUnit &a, const TranslationUnit &b)
+		{
+			return a.totalMemory > b.totalMemory;
+		});
+		return translationUnits;
+	}
+
+	Stats::Counters Stats::getTranslationUnitMemory() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		Counters memory;
+		for (auto &translationUnit : _translationUnits)
+		{
+			for (auto &pair : translationUnit.memory)
+				memory[pair.first] += pair.second;
+		}
+		return memory;
+	}
+
+	ScopedTimer::ScopedTimer(Stats *stats, const char *phase)
+		: _stats(stats)
+		, _phase(phase)
+	{
+		if (_stats)
+			_start = Stats::Clock::now();
+	}
+
+	ScopedTimer::~ScopedTimer()
+	{
+		if (!_stats)
+			return;
+
+		auto end = Stats::Clock::now();
+		_stats->addPhase(_phase, end - _start);
+
+		Trace *trace = _stats->getTrace();
+		if (trace)
+			trace->addSpan(_phase, _detail, _start, end);
+	}
+
+	Stats::Clock::duration ScopedTimer::getElapsed() const
+	{
+		return _stats ? Stats::Clock::now() - _start : Stats::Clock::duration::zero();
+	}
+
+	void ScopedTimer::setDetail(const std::string &detail)
+	{
+		if (_stats && _stats->getTrace())
+			_detail = detail;
+	}
+}
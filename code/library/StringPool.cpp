@@ -0,0 +1,130 @@
+#include <architect/StringPool.hpp>
+
+#include <stdexcept>
+
+namespace architect
+{
+	namespace
+	{
+		const std::string emptyString;
+	}
+
+	StringPool::StringPool()
+	{
+		clear();
+	}
+
+	void StringPool::clear()
+	{
+		for (auto &shard : _shards)
+		{
+			shard.ids.clear();
+			for (auto &chunk : shard.chunks)
+				chunk.reset();
+			shard.size = 0;
+		}
+
+		// reserves the first id for the empty string
+		_shards[0].size = 1;
+	}
+
+	void StringPool::copy(const StringPool &other)
+	{
+		for (uint32_t shardIndex = 0; shardIndex < shardCount; ++shardIndex)
+		{
+			Shard &shard = _shards[shardIndex];
+			const Shard &otherShard = other._shards[shardIndex];
+
+			shard.ids = otherShard.ids;
+			for (auto &chunk : shard.chunks)
+				chunk.reset();
+			shard.size = otherShard.size;
+
+			// chunks point to the keys of the map, which are now different
+			for (auto &pair : shard.ids)
+			{
+				uint32_t chunk, offset;
+				locate(pair.second >> shardBits, chunk, offset);
+				if (!shard.chunks[chunk])
+					shard.chunks[chunk].reset(new const std::string *[(size_t)1 << (chunk + firstChunkBits)]);
+				shard.chunks[chunk][offset] = &pair.first;
+			}
+		}
+	}
+
+	StringId StringPool::intern(const std::string &value)
+	{
+		if (value.empty())
+			return empty;
+
+		uint32_t shardIndex = (uint32_t)(std::hash<std::string>()(value) % shardCount);
+		Shard &shard = _shards[shardIndex];
+
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		auto it = shard.ids.find(value);
+		if (it != shard.ids.end())
+			return it->second;
+
+		uint32_t index = shard.size;
+		if (index >> (32 - shardBits))
+			throw std::length_error("Too many strings");
+
+		uint32_t chunk, offset;
+		locate(index, chunk, offset);
+		if (!shard.chunks[chunk])
+			shard.chunks[chunk].reset(new const std::string *[(size_t)1 << (chunk + firstChunkBits)]);
+
+		StringId id = (index << shardBits) | shardIndex;
+		it = shard.ids.insert(std::make_pair(value, id)).first;
+		shard.chunks[chunk][offset] = &it->first;
+		++shard.size;
+
+		return id;
+	}
+
+	bool StringPool::find(const std::string &value, StringId &id) const
+	{
+		if (value.empty())
+		{
+			id = empty;
+			return true;
+		}
+
+		uint32_t shardIndex = (uint32_t)(std::hash<std::string>()(value) % shardCount);
+		const Shard &shard = _shards[shardIndex];
+
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		auto it = shard.ids.find(value);
+		if (it == shard.ids.end())
+			return false;
+
+		id = it->second;
+		return true;
+	}
+
+	const std::string &StringPool::get(StringId id) const
+	{
+		if (id == empty)
+			return emptyString;
+
+		const Shard &shard = _shards[id & (shardCount - 1)];
+
+		uint32_t chunk, offset;
+		locate(id >> shardBits, chunk, offset);
+		return *shard.chunks[chunk][offset];
+	}
+
+	void StringPool::locate(uint32_t index, uint32_t &chunk, uint32_t &offset)
+	{
+		// chunk k holds 2^(k + firstChunkBits) strings
+		uint32_t biased = index + (1 << firstChunkBits);
+		uint32_t bits = firstChunkBits;
+		while (biased >> (bits + 1))
+			++bits;
+
+		chunk = bits - firstChunkBits;
+		offset = biased - (1 << bits);
+	}
+}
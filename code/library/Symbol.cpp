@@ -8,46 +8,111 @@ namespace architect
 		const std::string doubleColon("::");
 	}
 
+	bool SymbolIdentifier::operator==(const SymbolIdentifier &other) const
+	{
+		return name == other.name && type == other.type;
+	}
+
 	bool SymbolIdentifier::operator<(const SymbolIdentifier &other) const
 	{
-		auto compare = name.compare(other.name);
-		if (compare)
-			return compare < 0;
+		if (name != other.name)
+			return name < other.name;
+
+		return type < other.type;
+	}
+
+	size_t SymbolIdentifierHash::operator()(const SymbolIdentifier &identifier) const
+	{
+		return std::hash<uint64_t>()(((uint64_t)identifier.name << 32) | identifier.type);
+	}
+
+	const std::string &Namespace::getName() const
+	{
+		return strings->get(name);
+	}
+
+	const std::string &Symbol::getName() const
+	{
+		return ns->strings->get(identifier.name);
+	}
 
-		compare = type.compare(other.type);
-		return compare < 0;
+	const std::string &Symbol::getTypeName() const
+	{
+		return ns->strings->get(identifier.type);
+	}
+
+	void Namespace::computeQualifiedName()
+	{
+		qualifiedName.clear();
+		if (!parent)
+			return;
+
+		if (parent->parent)
+		{
+			qualifiedName = parent->qualifiedName;
+			qualifiedName += doubleColon;
+		}
+		qualifiedName += (name == StringPool::empty ? anonymous : getName());
 	}
 
 	std::string Symbol::getFullName() const
 	{
-		std::string name = (identifier.name.empty() ? anonymous : identifier.name);
+		std::string name;
+		appendFullName(name);
+		return name;
+	}
 
-		Namespace *iterNs = ns;
-		while (iterNs->parent)
+	void Symbol::appendFullName(std::string &buffer) const
+	{
+		if (type == SymbolType::GLOBAL ||
+			type == SymbolType::GLOBAL_TEMPLATE)
 		{
-			name = (iterNs->name.empty() ? anonymous : iterNs->name) + doubleColon + name;
-			iterNs = iterNs->parent;
+			buffer += getTypeName();
+			buffer += ' ';
 		}
 
+		if (ns->parent)
+		{
+			buffer += ns->qualifiedName;
+			buffer += doubleColon;
+		}
+
+		buffer += (identifier.name == StringPool::empty ? anonymous : getName());
+
 		if (!templateParameters.empty())
 		{
-			name += "<";
+			buffer += '<';
 			bool notFirst = false;
 			for (auto &param : templateParameters)
 			{
 				if (notFirst)
-					name += ", ";
+					buffer += ", ";
 				else
 					notFirst = true;
-				name += param;
+				buffer += param;
 			}
-			name += ">";
+			buffer += '>';
 		}
+	}
 
-		if (type == SymbolType::GLOBAL ||
-			type == SymbolType::GLOBAL_TEMPLATE)
-			name = identifier.type + " " + name;
+	Fingerprint Symbol::computeIdentityFingerprint() const
+	{
+		FingerprintBuilder builder;
+		builder.add((uint64_t)type);
+		builder.add(getName());
+		builder.add(getTypeName());
 
-		return name;
+		builder.add((uint64_t)templateParameters.size());
+		for (auto &param : templateParameters)
+			builder.add(param);
+
+		const Namespace *iterNs = ns;
+		while (iterNs->parent)
+		{
+			builder.add(iterNs->getName());
+			iterNs = iterNs->parent;
+		}
+
+		return builder.get();
 	}
 }
@@ -0,0 +1,112 @@
+#include <architect/Trace.hpp>
+
+#include <atomic>
+
+namespace architect
+{
+	namespace
+	{
+		std::atomic<uint64_t> nextGeneration(1);
+
+		struct ThreadCache
+		{
+			uint64_t generation;
+			void *buffer;
+		};
+
+		thread_local ThreadCache threadCache = { 0, nullptr };
+
+		void writeEscaped(std::ostream &stream, const char *str)
+		{
+			for (; *str; ++str)
+			{
+				char c = *str;
+				if (c == '"' || c == '\\')
+					stream << '\\' << c;
+				else if ((unsigned char)c < 0x20)
+					stream << ' ';
+				else
+					stream << c;
+			}
+		}
+	}
+
+	Trace::Trace()
+		: _generation(nextGeneration++)
+		, _origin(Clock::now())
+	{}
+
+	void Trace::addSpan(const char *name, const std::string &detail, Clock::time_point start, Clock::time_point end)
+	{
+		Span span;
+		span.name = name;
+		span.detail = detail;
+		span.start = std::chrono::duration_cast<std::chrono::microseconds>(start - _origin).count();
+		span.duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+		getThreadBuffer().spans.push_back(std::move(span));
+	}
+
+	void Trace::write(std::ostream &stream) const
+	{
+		stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+		bool notFirst = false;
+		for (auto &buffer : _buffers)
+		{
+			for (auto &span : buffer->spans)
+			{
+				if (notFirst)
+					stream << ",\n";
+				notFirst = true;
+
+				stream << "{\"name\":\"";
+				writeEscaped(stream, span.name);
+				stream << "\",\"cat\":\"architect\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadIndex
+					<< ",\"ts\":" << span.start << ",\"dur\":" << span.duration;
+				if (!span.detail.empty())
+				{
+					stream << ",\"args\":{\"detail\":\"";
+					writeEscaped(stream, span.detail.c_str());
+					stream << "\"}";
+				}
+				stream << "}";
+			}
+		}
+
+		stream << "]}\n";
+	}
+
+	Trace::ThreadBuffer &Trace::getThreadBuffer()
+	{
+		if (threadCache.generation == _generation)
+			return *static_cast<ThreadBuffer *>(threadCache.buffer);
+
+		// the cache only holds the last trace, another one may have been used in between
+		ThreadBuffer *bufferPtr = nullptr;
+		auto threadId = std::this_thread::get_id();
+		{
+			std::lock_guard<std::mutex> lock(_buffersMutex);
+			for (auto &buffer : _buffers)
+			{
+				if (buffer->threadId == threadId)
+				{
+					bufferPtr = buffer.get();
+					break;
+				}
+			}
+
+			if (!bufferPtr)
+			{
+				std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+				buffer->threadId = threadId;
+				buffer->threadIndex = (uint32_t)_buffers.size();
+				bufferPtr = buffer.get();
+				_buffers.push_back(std::move(buffer));
+			}
+		}
+
+		threadCache.generation = _generation;
+		threadCache.buffer = bufferPtr;
+		return *bufferPtr;
+	}
+}
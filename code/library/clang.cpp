@@ -1,7 +1,19 @@
 #ifdef ARCHITECT_CLANG_SUPPORT
 #include <architect/clang.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <clang-c/CXCompilationDatabase.h>
 #include <clang-c/Index.h>
+#include <architect/ClangString.hpp>
+#include <architect/Fingerprint.hpp>
 #include <architect/Registry.hpp>
 #include <architect/Symbol.hpp>
 #include <architect/util.hpp>
@@ -19,16 +31,16 @@ namespace architect
 			std::string subPrefix = prefix + "    ";
 
 			CXCursorKind cursorKind = clang_getCursorKind(cursor);
-			std::string cursorKindName(clang_getCString(clang_getCursorKindSpelling(cursorKind)));
+			std::string cursorKindName(ClangString(clang_getCursorKindSpelling(cursorKind)).c_str());
 
 			CXType type = clang_getCursorType(cursor);
-			std::string typeName(clang_getCString(clang_getTypeSpelling(type)));
-			std::string typeKindName(clang_getCString(clang_getTypeKindSpelling(type.kind)));
+			std::string typeName(ClangString(clang_getTypeSpelling(type)).c_str());
+			std::string typeKindName(ClangString(clang_getTypeKindSpelling(type.kind)).c_str());
 			int typeNumTemplateArguments = clang_Type_getNumTemplateArguments(type);
 
-			std::string cursorName(clang_getCString(clang_getCursorSpelling(cursor)));
-			std::string cursorDisplayName(clang_getCString(clang_getCursorDisplayName(cursor)));
-			std::string cursorUSR(clang_getCString(clang_getCursorUSR(cursor)));
+			std::string cursorName(ClangString(clang_getCursorSpelling(cursor)).c_str());
+			std::string cursorDisplayName(ClangString(clang_getCursorDisplayName(cursor)).c_str());
+			std::string cursorUSR(ClangString(clang_getCursorUSR(cursor)).c_str());
 			int cursorNumTemplateArguments = clang_Cursor_getNumTemplateArguments(cursor);
 
 			stream
@@ -48,8 +60,8 @@ namespace architect
 				for (int i = 0; i < typeNumTemplateArguments; ++i)
 				{
 					CXType argType = clang_Type_getTemplateArgumentAsType(type, i);
-					std::string argTypeName(clang_getCString(clang_getTypeSpelling(argType)));
-					std::string argTypeKindName(clang_getCString(clang_getTypeKindSpelling(argType.kind)));
+					std::string argTypeName(ClangString(clang_getTypeSpelling(argType)).c_str());
+					std::string argTypeKindName(ClangString(clang_getTypeKindSpelling(argType.kind)).c_str());
 					stream << subPrefix << argTypeName << " (" << argTypeKindName << ")" << std::endl;
 				}
 			}
@@ -60,8 +72,8 @@ namespace architect
 				CXCursor refCursor = clang_getCursorReferenced(cursor);
 				if (!clang_Cursor_isNull(refCursor))
 				{
-					std::string refName(clang_getCString(clang_getCursorSpelling(refCursor)));
-					std::string refUSR(clang_getCString(clang_getCursorUSR(refCursor)));
+					std::string refName(ClangString(clang_getCursorSpelling(refCursor)).c_str());
+					std::string refUSR(ClangString(clang_getCursorUSR(refCursor)).c_str());
 					stream << ": " << refName << " (" << refUSR << ")" << std::endl;
 				}
 				stream << std::endl;
@@ -70,8 +82,8 @@ namespace architect
 			CXCursor parentCursor = clang_getCursorSemanticParent(cursor);
 			if (!clang_Cursor_isNull(parentCursor))
 			{
-				std::string parentName(clang_getCString(clang_getCursorSpelling(parentCursor)));
-				std::string parentUSR(clang_getCString(clang_getCursorUSR(parentCursor)));
+				std::string parentName(ClangString(clang_getCursorSpelling(parentCursor)).c_str());
+				std::string parentUSR(ClangString(clang_getCursorUSR(parentCursor)).c_str());
 				stream << prefix << "  Parent: " << parentName << " (" << parentUSR << ")" << std::endl;
 			}
 
@@ -81,14 +93,90 @@ namespace architect
 		}
 #endif
 
+		// accumulated while visiting one translation unit, then added to the stats at once
+		struct VisitCounters
+		{
+			std::vector<uint64_t> cursorKinds;
+			uint64_t createdSymbols;
+			uint64_t externalSymbols;
+			uint64_t prunedCursors; // roots of the skipped subtrees
+
+			VisitCounters()
+				: createdSymbols(0)
+				, externalSymbols(0)
+				, prunedCursors(0)
+			{}
+		};
+
+		// Tells whether cursors are in system headers or under external directories, caching the latter per file.
+		class ExternalFilter
+		{
+		public:
+			explicit ExternalFilter(const std::vector<std::string> &directories)
+			{
+				for (auto directory : directories)
+				{
+					if (util::absolutePath(directory))
+						_directories.push_back(directory);
+				}
+			}
+
+			bool isExternal(const CXCursor &cursor)
+			{
+				return isExternal(clang_getCursorLocation(cursor));
+			}
+
+			bool isExternal(const CXSourceLocation &location)
+			{
+				if (clang_Location_isInSystemHeader(location))
+					return true;
+				if (_directories.empty())
+					return false;
+
+				CXFile file;
+				clang_getExpansionLocation(location, &file, nullptr, nullptr, nullptr);
+				if (!file)
+					return false;
+
+				auto it = _files.find(file);
+				if (it != _files.end())
+					return it->second;
+
+				bool external = false;
+				std::string filename = ClangString(clang_getFileName(file)).str();
+				if (util::absolutePath(filename))
+				{
+					for (auto &directory : _directories)
+					{
+						if (filename.size() > directory.size() && !filename.compare(0, directory.size(), directory)
+							&& (filename[directory.size()] == '/' || filename[directory.size()] == '\\'))
+						{
+							external = true;
+							break;
+						}
+					}
+				}
+
+				_files[file] = external;
+				return external;
+			}
+
+		private:
+			std::vector<std::string> _directories; // absolute
+			std::unordered_map<CXFile, bool> _files;
+		};
+
 		class VisitorContext
 		{
 		public:
 			const clang::Parameters &parameters;
 
-			VisitorContext(Registry *registry, clang::Parameters &_parameters)
-				: _registry(registry)
-				, parameters(_parameters)
+			VisitorContext(Registry *registry, ReferenceBuffer *references, VisitCounters *counters, ExternalFilter *externalFilter, clang::Parameters &_parameters)
+				: parameters(_parameters)
+				, _registry(registry)
+				, _references(references)
+				, _counters(counters)
+				, _externalFilter(externalFilter)
 				, _currentNameSpace(&registry->rootNameSpace)
 				, _currentSymbol(nullptr)
 				, _referenceType(ReferenceType::ASSOCIATION)
@@ -96,6 +184,28 @@ namespace architect
 				, _inTemplateParameter(false)
 			{}
 
+			void countCursor(CXCursorKind kind) const
+			{
+				if (!_counters)
+					return;
+
+				if ((size_t)kind >= _counters->cursorKinds.size())
+					_counters->cursorKinds.resize(kind + 1, 0);
+				++_counters->cursorKinds[kind];
+			}
+
+			// always false when not pruning
+			bool isExternal(const CXCursor &cursor) const
+			{
+				return _externalFilter && _externalFilter->isExternal(cursor);
+			}
+
+			void countPrunedCursor() const
+			{
+				if (_counters)
+					++_counters->prunedCursors;
+			}
+
 			VisitorContext setReferenceType(ReferenceType referenceType) const
 			{
 				VisitorContext subContext(*this);
@@ -106,7 +216,7 @@ namespace architect
 			VisitorContext setInMethod(const CXCursor &cursor) const
 			{
 				SymbolIdentifier identifier;
-				Symbol *symbol = getSymbol(cursor, identifier);
+				Symbol *symbol = getSymbol(cursor, identifier, false);
 
 				VisitorContext subContext(*this);
 				subContext._currentSymbol = symbol;
@@ -117,11 +227,8 @@ namespace architect
 
 			VisitorContext declareNamespace(const CXCursor &cursor)
 			{
-				auto subNamespace = _registry->createNamespace();
-				subNamespace->parent = _currentNameSpace;
-				subNamespace->name = clang_getCString(clang_getCursorSpelling(cursor));
-
-				_currentNameSpace->children.insert(std::pair<std::string, Namespace *>(subNamespace->name, subNamespace));
+				StringId name = _registry->strings.intern(ClangString(clang_getCursorSpelling(cursor)).str());
+				auto subNamespace = _registry->getOrCreateNamespace(_currentNameSpace, name);
 
 				VisitorContext subContext(*this);
 				subContext._currentNameSpace = subNamespace;
@@ -158,8 +265,11 @@ namespace architect
 				if (_inTemplateParameter)
 					return *this;
 
-				auto name = clang_getCString(clang_getCursorSpelling(cursor));
-				_currentSymbol->templateParameters.push_back(name);
+				ClangString name(clang_getCursorSpelling(cursor));
+				{
+					std::lock_guard<std::mutex> lock(_registry->getMutex(_currentSymbol));
+					_currentSymbol->templateParameters.push_back(name.str());
+				}
 
 				VisitorContext subContext(*this);
 				subContext._referenceType = ReferenceType::ASSOCIATION;
@@ -180,7 +290,15 @@ namespace architect
 			void declareReference(const CXCursor &cursor, const CXCursor &referenceCursor)
 			{
 				SymbolIdentifier identifier;
-				Symbol *symbol = getSymbol(cursor, identifier);
+				Symbol *symbol = getSymbol(cursor, identifier, false);
+
+				// the declarations of external headers were skipped, their symbols are only created once referenced
+				if (!symbol && _currentSymbol && _externalFilter)
+				{
+					CXCursor referencedCursor = clang_getCursorReferenced(cursor);
+					if (!clang_Cursor_isNull(referencedCursor) && _externalFilter->isExternal(referencedCursor))
+						symbol = declareExternalSymbol(referencedCursor);
+				}
 
 				if (symbol && _currentSymbol && symbol != _currentSymbol)
 				{
@@ -188,19 +306,17 @@ namespace architect
 					reference.location.getFromCursor(referenceCursor);
 					reference.type = _referenceType;
 
-					auto &referenceSet = _currentSymbol->references[symbol->id];
-					referenceSet.insert(reference);
+					_references->insert(_currentSymbol, symbol->id, reference);
 				}
 			}
 
 		private:
-			Symbol *getSymbol(const CXCursor &cursor, SymbolIdentifier &identifier) const
+			// when not interning, unknown strings mean that the symbol does not exist yet
+			Symbol *getSymbol(const CXCursor &cursor, SymbolIdentifier &identifier, bool intern) const
 			{
 				CXType type = clang_getCursorType(cursor);
 
-				identifier.name = clang_getCString(clang_getCursorSpelling(cursor));
-				identifier.type = clang_getCString(clang_getTypeSpelling(type));
-
+				bool isLookedUp;
 				switch (type.kind)
 				{
 				case CXType_Enum:
@@ -208,6 +324,25 @@ namespace architect
 				case CXType_Invalid:
 				case CXType_Record:
 				case CXType_Typedef:
+					isLookedUp = true;
+					break;
+
+				default:
+					isLookedUp = false;
+				}
+
+				// spellings are only needed for the identifier of a new symbol, or for a lookup
+				if (intern)
+				{
+					identifier.name = _registry->strings.intern(ClangString(clang_getCursorSpelling(cursor)).str());
+					identifier.type = _registry->strings.intern(ClangString(clang_getTypeSpelling(type)).str());
+				}
+				else if (!isLookedUp
+					|| !_registry->strings.find(ClangString(clang_getCursorSpelling(cursor)).str(), identifier.name)
+					|| !_registry->strings.find(ClangString(clang_getTypeSpelling(type)).str(), identifier.type))
+					return nullptr;
+
+				if (isLookedUp)
 				{
 					std::list<std::string> namespaces;
 					clang_visitChildren(cursor, nameSpaceVisitor, &namespaces);
@@ -221,9 +356,6 @@ namespace architect
 
 						ns = ns->parent;
 					} while (ns);
-
-					break;
-				}
 				}
 
 				return nullptr;
@@ -232,19 +364,22 @@ namespace architect
 			Symbol *declareSymbol(SymbolType symbolType, const CXCursor &cursor, const CXCursor &referenceCursor, bool &wasDefined)
 			{
 				SymbolIdentifier identifier;
-				Symbol *symbol = getSymbol(cursor, identifier);
+				Symbol *symbol = getSymbol(cursor, identifier, true);
 				if (!symbol)
 				{
-					symbol = _registry->createSymbol(symbolType, false);
-					symbol->identifier = identifier;
-					symbol->ns = _currentNameSpace;
-
-					_currentNameSpace->symbols.insert(std::pair<SymbolIdentifier, Symbol *>(identifier, symbol));
+					bool created;
+					symbol = _registry->getOrCreateSymbol(_currentNameSpace, identifier, symbolType, &created);
+					if (created && _counters)
+						++_counters->createdSymbols;
 				}
 
-				wasDefined = symbol->defined;
-				if (clang_isCursorDefinition(cursor))
-					symbol->defined = true;
+				bool isDefinition = clang_isCursorDefinition(cursor) != 0;
+				{
+					std::lock_guard<std::mutex> lock(_registry->getMutex(symbol));
+					wasDefined = symbol->defined;
+					if (isDefinition)
+						symbol->defined = true;
+				}
 
 				if (_currentSymbol && symbol != _currentSymbol)
 				{
@@ -252,44 +387,69 @@ namespace architect
 					reference.location.getFromCursor(referenceCursor);
 					reference.type = _referenceType;
 
-					auto &referenceSet = _currentSymbol->references[symbol->id];
-					referenceSet.insert(reference);
+					_references->insert(_currentSymbol, symbol->id, reference);
 				}
 
 				return symbol;
 			}
 
-			static Symbol *findSymbol(SymbolIdentifier &identifier, std::list<std::string> &namespaces, const Namespace *ns)
+			// in the namespaces enclosing the declaration, whatever the current namespace
+			Symbol *declareExternalSymbol(const CXCursor &cursor)
+			{
+				std::vector<CXCursor> nameSpaceCursors;
+				CXCursor parentCursor = clang_getCursorSemanticParent(cursor);
+				while (!clang_Cursor_isNull(parentCursor))
+				{
+					CXCursorKind kind = clang_getCursorKind(parentCursor);
+					if (clang_isTranslationUnit(kind) || clang_isInvalid(kind))
+						break;
+					if (kind == CXCursor_Namespace)
+						nameSpaceCursors.push_back(parentCursor);
+					parentCursor = clang_getCursorSemanticParent(parentCursor);
+				}
+
+				Namespace *ns = &_registry->rootNameSpace;
+				for (auto it = nameSpaceCursors.rbegin(); it != nameSpaceCursors.rend(); ++it)
+					ns = _registry->getOrCreateNamespace(ns, _registry->strings.intern(ClangString(clang_getCursorSpelling(*it)).str()));
+
+				SymbolIdentifier identifier;
+				identifier.name = _registry->strings.intern(ClangString(clang_getCursorSpelling(cursor)).str());
+				identifier.type = _registry->strings.intern(ClangString(clang_getTypeSpelling(clang_getCursorType(cursor))).str());
+
+				bool created;
+				Symbol *symbol = _registry->getOrCreateSymbol(ns, identifier, SymbolType::EXTERNAL, &created);
+				if (created && _counters)
+					++_counters->externalSymbols;
+				return symbol;
+			}
+
+			Symbol *findSymbol(SymbolIdentifier &identifier, std::list<std::string> &namespaces, const Namespace *ns) const
 			{
 				const Namespace *finalNameSpace = ns;
 				auto itName = namespaces.begin();
 				while (itName != namespaces.end())
 				{
-					auto itChild = finalNameSpace->children.find(*itName);
-					if (itChild == finalNameSpace->children.end())
+					StringId name;
+					if (!_registry->strings.find(*itName, name))
+						break;
+					const Namespace *child = _registry->findNamespace(finalNameSpace, name);
+					if (!child)
 						break;
-					finalNameSpace = itChild->second;
+					finalNameSpace = child;
 					++itName;
 				}
 
 				if (itName == namespaces.end())
 				{
-					auto it = finalNameSpace->symbols.find(identifier);
-					if (it != finalNameSpace->symbols.end())
-					{
-						return it->second;
-					}
+					Symbol *symbol = _registry->findSymbol(finalNameSpace, identifier);
+					if (symbol)
+						return symbol;
 				}
 
-				for (auto &child : ns->children)
-				{
-					if (child.first.empty())
-					{
-						Symbol *symbol = findSymbol(identifier, namespaces, child.second);
-						if (symbol)
-							return symbol;
-					}
-				}
+				// children names are unique, so there is at most one anonymous namespace
+				const Namespace *anonymousNameSpace = _registry->findNamespace(ns, StringPool::empty);
+				if (anonymousNameSpace)
+					return findSymbol(identifier, namespaces, anonymousNameSpace);
 
 				return nullptr;
 			}
@@ -299,14 +459,16 @@ namespace architect
 				CXCursorKind kind = clang_getCursorKind(cursor);
 				if (kind == CXCursor_NamespaceRef)
 				{
-					std::string name = clang_getCString(clang_getCursorSpelling(cursor));
 					std::list<std::string> &_namespaces = *static_cast<std::list<std::string> *>(clientData);
-					_namespaces.push_back(name);
+					_namespaces.push_back(ClangString(clang_getCursorSpelling(cursor)).str());
 				}
 				return CXChildVisit_Continue;
 			}
 
 			Registry *_registry;
+			ReferenceBuffer *_references;
+			VisitCounters *_counters;
+			ExternalFilter *_externalFilter; // null when not pruning
 			Namespace *_currentNameSpace;
 			Symbol *_currentSymbol;
 			ReferenceType _referenceType;
@@ -319,7 +481,6 @@ namespace architect
 
 		bool handleReference(CXCursor &cursor, VisitorContext &context)
 		{
-			auto name = clang_getCString(clang_getCursorSpelling(cursor));
 			CXCursorKind kind = clang_getCursorKind(cursor);
 			switch (kind)
 			{
@@ -330,7 +491,10 @@ namespace architect
 					CXCursor referencedCursor = clang_getCursorReferenced(cursor);
 					if (!clang_Cursor_isNull(referencedCursor))
 					{
-						globalVisitor(referencedCursor, cursor, &context);
+						if (context.isExternal(referencedCursor))
+							context.declareReference(referencedCursor, cursor);
+						else
+							globalVisitor(referencedCursor, cursor, &context);
 					}
 				}
 				break;
@@ -367,11 +531,11 @@ namespace architect
 		CXChildVisitResult functionVisitor(CXCursor cursor, CXCursor parent, CXClientData clientData)
 		{
 			VisitorContext &context = *static_cast<VisitorContext *>(clientData);
+			context.countCursor(clang_getCursorKind(cursor));
 
 			if (handleReference(cursor, context))
 				return CXChildVisit_Continue;
 
-			auto name = clang_getCString(clang_getCursorSpelling(cursor));
 			CXCursorKind kind = clang_getCursorKind(cursor);
 			switch (kind)
 			{
@@ -388,6 +552,14 @@ namespace architect
 		CXChildVisitResult globalVisitor(CXCursor cursor, CXCursor parent, CXClientData clientData)
 		{
 			VisitorContext &context = *static_cast<VisitorContext *>(clientData);
+			context.countCursor(clang_getCursorKind(cursor));
+
+			// before the filter, which resolves the path of every cursor
+			if (context.isExternal(cursor))
+			{
+				context.countPrunedCursor();
+				return CXChildVisit_Continue;
+			}
 
 			if (context.parameters.filter)
 			{
@@ -395,7 +567,7 @@ namespace architect
 				unsigned int line, column;
 				CXSourceLocation sourceLocation = clang_getCursorLocation(cursor);
 				clang_getPresumedLocation(sourceLocation, &cfilename, &line, &column);
-				std::string filename = clang_getCString(cfilename);
+				std::string filename = ClangString(cfilename).str();
 				if (!util::absolutePath(filename))
 					return CXChildVisit_Continue;
 				if (!context.parameters.filter(filename))
@@ -405,7 +577,6 @@ namespace architect
 			if (handleReference(cursor, context))
 				return CXChildVisit_Continue;
 
-			auto name = clang_getCString(clang_getCursorSpelling(cursor));
 			CXCursorKind kind = clang_getCursorKind(cursor);
 			switch (kind)
 			{
@@ -470,14 +641,892 @@ namespace architect
 
 			return CXChildVisit_Continue;
 		}
+
+		std::string getFilename(const CXTranslationUnit translationUnit)
+		{
+			return ClangString(clang_getTranslationUnitSpelling(translationUnit)).str();
+		}
+
+		void addTranslationUnitStats(Stats &stats, const CXTranslationUnit translationUnit, const VisitCounters &counters, Stats::TranslationUnit &usage)
+		{
+			Stats::Counters statsCounters;
+			statsCounters["symbols.created"] = counters.createdSymbols;
+			statsCounters["symbols.external"] = counters.externalSymbols;
+			statsCounters["cursors.pruned"] = counters.prunedCursors;
+
+			usage.cursorCount = 0;
+			for (size_t kind = 0; kind < counters.cursorKinds.size(); ++kind)
+			{
+				if (!counters.cursorKinds[kind])
+					continue;
+
+				ClangString spelling(clang_getCursorKindSpelling((CXCursorKind)kind));
+				statsCounters[std::string("cursors.") + spelling.c_str()] = counters.cursorKinds[kind];
+
+				usage.cursorCount += counters.cursorKinds[kind];
+			}
+			stats.addCounters(statsCounters);
+
+			usage.totalMemory = 0;
+			CXTUResourceUsage resourceUsage = clang_getCXTUResourceUsage(translationUnit);
+			for (unsigned int i = 0; i < resourceUsage.numEntries; ++i)
+			{
+				auto &entry = resourceUsage.entries[i];
+				if (entry.kind < CXTUResourceUsage_MEMORY_IN_BYTES_BEGIN || entry.kind > CXTUResourceUsage_MEMORY_IN_BYTES_END)
+					continue;
+
+				usage.memory[clang_getTUResourceUsageName(entry.kind)] += entry.amount;
+				usage.totalMemory += entry.amount;
+			}
+			clang_disposeCXTUResourceUsage(resourceUsage);
+
+			stats.addTranslationUnit(usage);
+		}
+
+		class InclusionVisitorContext
+		{
+		public:
+			InclusionVisitorContext(Registry &registry, ReferenceBuffer &references, VisitCounters *counters, ExternalFilter *externalFilter, const CXTranslationUnit translationUnit, const clang::Parameters &parameters)
+				: _registry(registry)
+				, _references(references)
+				, _counters(counters)
+				, _externalFilter(externalFilter)
+				, _translationUnit(translationUnit)
+				, _parameters(parameters)
+			{}
+
+			void declareInclusion(CXFile includedFile, CXSourceLocation *inclusionStack, unsigned inclusionDepth)
+			{
+				Symbol *includedSymbol = getFileSymbol(includedFile);
+				if (!includedSymbol || !inclusionDepth)
+					return;
+
+				// the first location of the stack is the directive in the including file
+				CXFile includingFile;
+				Reference reference;
+				clang_getExpansionLocation(inclusionStack[0], &includingFile, &reference.location.line, &reference.location.column, nullptr);
+
+				Symbol *includingSymbol = getFileSymbol(includingFile);
+				if (!includingSymbol || includingSymbol == includedSymbol)
+					return;
+
+				reference.location.filename = includingSymbol->getName();
+				reference.type = ReferenceType::INCLUSION;
+				_references.insert(includingSymbol, includedSymbol->id, reference);
+			}
+
+		private:
+			// null if the file is filtered out
+			Symbol *getFileSymbol(CXFile file)
+			{
+				if (!file)
+					return nullptr;
+
+				auto it = _symbols.find(file);
+				if (it != _symbols.end())
+					return it->second;
+
+				Symbol *symbol = nullptr;
+				std::string filename = ClangString(clang_getFileName(file)).str();
+				if (util::absolutePath(filename)
+					&& (!_externalFilter || !_externalFilter->isExternal(clang_getLocation(_translationUnit, file, 1, 1)))
+					&& (!_parameters.filter || _parameters.filter(filename)))
+				{
+					SymbolIdentifier identifier;
+					identifier.name = _registry.strings.intern(filename);
+					identifier.type = StringPool::empty;
+
+					bool created;
+					symbol = _registry.getOrCreateSymbol(&_registry.rootNameSpace, identifier, SymbolType::FILE, &created);
+					if (created && _counters)
+						++_counters->createdSymbols;
+
+					std::lock_guard<std::mutex> lock(_registry.getMutex(symbol));
+					symbol->defined = true;
+				}
+
+				_symbols[file] = symbol;
+				return symbol;
+			}
+
+			Registry &_registry;
+			ReferenceBuffer &_references;
+			VisitCounters *_counters;
+			ExternalFilter *_externalFilter; // null when not pruning
+			const CXTranslationUnit _translationUnit;
+			const clang::Parameters &_parameters;
+			std::unordered_map<CXFile, Symbol *> _symbols;
+		};
+
+		void inclusionVisitor(CXFile includedFile, CXSourceLocation *inclusionStack, unsigned inclusionDepth, CXClientData clientData)
+		{
+			auto &context = *static_cast<InclusionVisitorContext *>(clientData);
+			context.declareInclusion(includedFile, inclusionStack, inclusionDepth);
+		}
+
+		unsigned getParseOptions(const clang::Parameters &parameters)
+		{
+			// declarations are not visited in the include graph, only the preprocessor matters
+			return parameters.includeGraph ? CXTranslationUnit_SkipFunctionBodies : CXTranslationUnit_None;
+		}
+
+		void visitTranslationUnit(Registry &registry, const CXTranslationUnit translationUnit, clang::Parameters &parameters, Stats::Clock::duration parseDuration)
+		{
+			CXCursor rootCursor = clang_getTranslationUnitCursor(translationUnit);
+
+#ifdef ARCHITECT_CLANG_PRINT_CURSORS
+			std::string prefix;
+			clang_visitChildren(rootCursor, printCursorsVisitor, &prefix);
+#endif
+
+			Stats::TranslationUnit usage;
+			if (parameters.stats)
+			{
+				usage.filename = getFilename(translationUnit);
+				usage.parseDuration = parseDuration;
+			}
+
+			VisitCounters counters;
+			{
+				ScopedTimer timer(parameters.stats, "visit");
+				timer.setDetail(usage.filename);
+
+				ReferenceBuffer references(registry, 1024, parameters.stats);
+				ExternalFilter externalFilter(parameters.externalDirectories);
+				if (parameters.includeGraph)
+				{
+					InclusionVisitorContext context(registry, references, parameters.stats ? &counters : nullptr, parameters.pruneExternal ? &externalFilter : nullptr, translationUnit, parameters);
+					clang_getInclusions(translationUnit, inclusionVisitor, &context);
+				}
+				else
+				{
+					VisitorContext context(&registry, &references, parameters.stats ? &counters : nullptr, parameters.pruneExternal ? &externalFilter : nullptr, parameters);
+					clang_visitChildren(rootCursor, globalVisitor, &context);
+				}
+
+				usage.visitDuration = timer.getElapsed();
+			}
+
+			if (parameters.stats)
+				addTranslationUnitStats(*parameters.stats, translationUnit, counters, usage);
+		}
+
+		CXTranslationUnit parseTranslationUnit(CXIndex index, const char *filename, const char *const *argv, int argc, unsigned options, Stats *stats, Stats::Clock::duration &parseDuration)
+		{
+			ScopedTimer timer(stats, "parse");
+			CXTranslationUnit translationUnit = nullptr;
+			if (clang_parseTranslationUnit2(index, filename, argv, argc, 0, 0, options, &translationUnit) != CXError_Success)
+				translationUnit = nullptr;
+
+			if (translationUnit && stats && stats->getTrace())
+				timer.setDetail(getFilename(translationUnit));
+			parseDuration = timer.getElapsed();
+			return translationUnit;
+		}
+
+		CXTranslationUnit loadTranslationUnit(CXIndex index, const std::string &astFilename, Stats *stats, Stats::Clock::duration &loadDuration)
+		{
+			ScopedTimer timer(stats, "load");
+			timer.setDetail(astFilename);
+
+			CXTranslationUnit translationUnit = nullptr;
+			if (clang_createTranslationUnit2(index, astFilename.c_str(), &translationUnit) != CXError_Success)
+				translationUnit = nullptr;
+
+			loadDuration = timer.getElapsed();
+			return translationUnit;
+		}
+
+		bool hasDiagnostics(const CXTranslationUnit translationUnit, CXDiagnosticSeverity minSeverity)
+		{
+			unsigned count = clang_getNumDiagnostics(translationUnit);
+			for (unsigned i = 0; i < count; ++i)
+			{
+				CXDiagnostic diagnostic = clang_getDiagnostic(translationUnit, i);
+				bool found = clang_getDiagnosticSeverity(diagnostic) >= minSeverity;
+				clang_disposeDiagnostic(diagnostic);
+				if (found)
+					return true;
+			}
+			return false;
+		}
+
+		// e.g. the precompiled header was built with other options, or cannot be read
+		bool hasPCHErrors(const CXTranslationUnit translationUnit)
+		{
+			unsigned count = clang_getNumDiagnostics(translationUnit);
+			for (unsigned i = 0; i < count; ++i)
+			{
+				CXDiagnostic diagnostic = clang_getDiagnostic(translationUnit, i);
+				bool found = false;
+				if (clang_getDiagnosticSeverity(diagnostic) >= CXDiagnostic_Error)
+				{
+					std::string category = ClangString(clang_getDiagnosticCategoryText(diagnostic)).str();
+					std::string text = ClangString(clang_getDiagnosticSpelling(diagnostic)).str();
+					found = category == "AST Deserialization Issue" || text.find("PCH") != std::string::npos || text.find("precompiled header") != std::string::npos;
+				}
+				clang_disposeDiagnostic(diagnostic);
+				if (found)
+					return true;
+			}
+			return false;
+		}
+
+		struct CompileCommand
+		{
+			std::string directory;
+			std::string filename; // empty if not found in the arguments
+			std::vector<std::string> arguments; // without the compiler
+		};
+
+		bool isAbsolutePath(const std::string &path)
+		{
+			return (!path.empty() && (path[0] == '/' || path[0] == '\\')) || (path.size() > 1 && path[1] == ':');
+		}
+
+		bool isSourceFile(const std::string &argument)
+		{
+			static const char *const extensions[] = { ".c", ".cc", ".cpp", ".cxx", ".c++", ".C", ".m", ".mm" };
+
+			auto dot = argument.rfind('.');
+			if (dot == std::string::npos)
+				return false;
+
+			for (auto extension : extensions)
+			{
+				if (!argument.compare(dot, std::string::npos, extension))
+					return true;
+			}
+			return false;
+		}
+
+		// first source file of the arguments, empty if none
+		std::string findSourceFile(const char *const *argv, int argc)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				if (isSourceFile(argv[i]) && strcmp(argv[i - 1], "-o"))
+					return argv[i];
+			}
+			return std::string();
+		}
+
+		struct CacheValidationContext
+		{
+			int64_t astTime;
+			bool upToDate;
+		};
+
+		void cacheValidationVisitor(CXFile file, CXSourceLocation *, unsigned, CXClientData clientData)
+		{
+			auto &context = *static_cast<CacheValidationContext *>(clientData);
+			if (!context.upToDate)
+				return;
+
+			// same second as the AST file: may have been written after it
+			int64_t time;
+			if (!util::lastWriteTime(ClangString(clang_getFileName(file)).str(), time) || time >= context.astTime)
+				context.upToDate = false;
+		}
+
+		// the AST file is named after the source file, and the arguments and working directory it was parsed with
+		std::string getCachedAstFilename(const std::string &directory, const std::string &sourceFilename, const char *const *argv, int argc, unsigned options)
+		{
+			FingerprintBuilder builder;
+			builder.add(sourceFilename);
+			builder.add((uint64_t)options);
+			for (int i = 0; i < argc; ++i)
+				builder.add(argv[i]);
+
+			std::string workingDirectory;
+			util::currentWorkingDirectory(workingDirectory);
+			builder.add(workingDirectory);
+
+			auto slash = sourceFilename.find_last_of("/\\");
+			auto basename = slash == std::string::npos ? sourceFilename : sourceFilename.substr(slash + 1);
+			return directory + "/" + basename + "-" + builder.get().toString() + ".ast";
+		}
+
+		// Loads the translation unit from the AST cache of the session if none of its files changed since it was saved,
+		// otherwise parses it and saves it to the cache if it has no errors.
+		CXTranslationUnit parseCachedTranslationUnit(clang::Session &session, CXIndex index, const std::string &sourceFilename, const char *const *argv, int argc, unsigned options, Stats *stats, Stats::Clock::duration &parseDuration)
+		{
+			auto &cacheDirectory = session.getParameters().astCacheDirectory;
+			if (cacheDirectory.empty() || sourceFilename.empty())
+				return parseTranslationUnit(index, 0, argv, argc, options, stats, parseDuration);
+
+			std::string astFilename = getCachedAstFilename(cacheDirectory, sourceFilename, argv, argc, options);
+
+			CacheValidationContext context;
+			if (util::lastWriteTime(astFilename, context.astTime))
+			{
+				CXTranslationUnit translationUnit = loadTranslationUnit(index, astFilename, stats, parseDuration);
+				if (translationUnit)
+				{
+					context.upToDate = true;
+					clang_getInclusions(translationUnit, cacheValidationVisitor, &context);
+					if (context.upToDate)
+						return translationUnit;
+
+					clang_disposeTranslationUnit(translationUnit);
+				}
+			}
+
+			CXTranslationUnit translationUnit = parseTranslationUnit(index, 0, argv, argc, options, stats, parseDuration);
+			if (translationUnit && !hasDiagnostics(translationUnit, CXDiagnostic_Error))
+			{
+				// saved aside then renamed, so that concurrent loads never see a partial file, even from other processes
+				std::ostringstream temporaryFilename;
+				temporaryFilename << astFilename << "." << util::processId() << "-" << std::this_thread::get_id();
+				if (clang_saveTranslationUnit(translationUnit, temporaryFilename.str().c_str(), clang_defaultSaveOptions(translationUnit)) == CXSaveError_None)
+				{
+					std::remove(astFilename.c_str());
+					if (std::rename(temporaryFilename.str().c_str(), astFilename.c_str()))
+						std::remove(temporaryFilename.str().c_str());
+				}
+			}
+			return translationUnit;
+		}
+
+		bool loadCompileCommands(const std::string &buildDirectory, std::vector<CompileCommand> &commands)
+		{
+			CXCompilationDatabase_Error error;
+			CXCompilationDatabase database = clang_CompilationDatabase_fromDirectory(buildDirectory.c_str(), &error);
+			if (error != CXCompilationDatabase_NoError)
+				return false;
+
+			CXCompileCommands databaseCommands = clang_CompilationDatabase_getAllCompileCommands(database);
+			unsigned commandCount = clang_CompileCommands_getSize(databaseCommands);
+			for (unsigned i = 0; i < commandCount; ++i)
+			{
+				CXCompileCommand databaseCommand = clang_CompileCommands_getCommand(databaseCommands, i);
+
+				CompileCommand command;
+				command.directory = ClangString(clang_CompileCommand_getDirectory(databaseCommand)).str();
+
+				unsigned argumentCount = clang_CompileCommand_getNumArgs(databaseCommand);
+				for (unsigned j = 1; j < argumentCount; ++j)
+				{
+					std::string argument = ClangString(clang_CompileCommand_getArg(databaseCommand, j)).str();
+
+					// the source file is not otherwise given by this version of libclang
+					if (command.filename.empty() && isSourceFile(argument) && (command.arguments.empty() || command.arguments.back() != "-o"))
+						command.filename = isAbsolutePath(argument) ? argument : command.directory + "/" + argument;
+
+					command.arguments.push_back(argument);
+				}
+
+				commands.push_back(command);
+			}
+
+			clang_CompileCommands_dispose(databaseCommands);
+			clang_CompilationDatabase_dispose(database);
+			return true;
+		}
+
+		// #include <...> directives at the beginning of the file, before any other code or quoted include
+		std::vector<std::string> readLeadingSystemIncludes(const std::string &filename)
+		{
+			std::vector<std::string> includes;
+
+			std::ifstream file(filename);
+			std::string line;
+			bool inComment = false;
+			while (std::getline(file, line))
+			{
+				size_t begin = line.find_first_not_of(" \t\r");
+				if (begin == std::string::npos)
+					continue;
+				line = line.substr(begin, line.find_last_not_of(" \t\r") + 1 - begin);
+
+				if (inComment)
+				{
+					if (line.find("*/") != std::string::npos)
+						inComment = false;
+					continue;
+				}
+				if (!line.compare(0, 2, "//"))
+					continue;
+				if (!line.compare(0, 2, "/*"))
+				{
+					inComment = line.find("*/", 2) == std::string::npos;
+					continue;
+				}
+
+				if (line.compare(0, 1, "#"))
+					break;
+
+				size_t directive = line.find_first_not_of(" \t", 1);
+				if (directive == std::string::npos || line.compare(directive, 7, "include"))
+					break;
+
+				size_t path = line.find_first_not_of(" \t", directive + 7);
+				if (path == std::string::npos || line[path] != '<')
+					break;
+
+				includes.push_back(line.substr(path, line.find('>', path) + 1 - path));
+			}
+
+			return includes;
+		}
+
+		std::vector<std::string> computeCommonIncludes(const std::vector<CompileCommand> &commands)
+		{
+			std::vector<std::string> commonIncludes;
+			bool first = true;
+			for (auto &command : commands)
+			{
+				if (command.filename.empty())
+					continue;
+
+				auto includes = readLeadingSystemIncludes(command.filename);
+				if (first)
+				{
+					commonIncludes = includes;
+					first = false;
+				}
+				else
+				{
+					size_t commonCount = 0;
+					while (commonCount < commonIncludes.size() && commonCount < includes.size() && commonIncludes[commonCount] == includes[commonCount])
+						++commonCount;
+					commonIncludes.resize(commonCount);
+				}
+
+				if (commonIncludes.empty())
+					break;
+			}
+			return commonIncludes;
+		}
+
+		// Writes and precompiles a header with the common includes, with the arguments of the first command.
+		// Returns the path of the precompiled header, the header name followed by .pch, empty on failure.
+		std::string buildPCH(Registry &registry, clang::Session &session, const std::vector<CompileCommand> &commands, const std::vector<std::string> &includes, const std::string &headerFilename, clang::Parameters &parameters)
+		{
+			ScopedTimer timer(parameters.stats, "pch");
+
+			std::string pchFilename = headerFilename + ".pch";
+			{
+				std::ofstream header(headerFilename);
+				if (!header.is_open())
+					return std::string();
+
+				for (auto &include : includes)
+					header << "#include " << include << std::endl;
+			}
+
+			// the includes were read from the commands having a source file
+			auto &command = *std::find_if(commands.begin(), commands.end(), [](const CompileCommand &command)
+			{
+				return !command.filename.empty();
+			});
+			std::vector<const char *> argv;
+			for (size_t i = 0; i < command.arguments.size(); ++i)
+			{
+				auto &argument = command.arguments[i];
+				if (argument == "-o" || argument == "-x")
+				{
+					++i;
+					continue;
+				}
+				if (argument == "-c" || argument == command.filename || command.directory + "/" + argument == command.filename)
+					continue;
+				argv.push_back(argument.c_str());
+			}
+			argv.push_back("-working-directory");
+			argv.push_back(command.directory.c_str());
+			argv.push_back("-x");
+			bool isC = command.filename.size() > 2 && !command.filename.compare(command.filename.size() - 2, 2, ".c");
+			argv.push_back(isC ? "c-header" : "c++-header");
+
+			CXIndex index = session.acquireIndex();
+			if (!index)
+				return std::string();
+
+			Stats::Clock::duration parseDuration;
+			CXTranslationUnit translationUnit = parseTranslationUnit(index, headerFilename.c_str(), argv.data(), (int)argv.size(),
+				CXTranslationUnit_ForSerialization | CXTranslationUnit_Incomplete, parameters.stats, parseDuration);
+
+			bool saved = false;
+			if (translationUnit)
+			{
+				if (!hasDiagnostics(translationUnit, CXDiagnostic_Fatal))
+				{
+					saved = clang_saveTranslationUnit(translationUnit, pchFilename.c_str(), clang_defaultSaveOptions(translationUnit)) == CXSaveError_None;
+
+					// the only visit of the declarations of the precompiled header
+					if (saved)
+						visitTranslationUnit(registry, translationUnit, parameters, parseDuration);
+				}
+				clang_disposeTranslationUnit(translationUnit);
+			}
+			session.releaseIndex(index);
+
+			return saved ? pchFilename : std::string();
+		}
+
+		// valid as long as the command
+		std::vector<const char *> getArguments(const CompileCommand &command)
+		{
+			std::vector<const char *> argv;
+			for (auto &argument : command.arguments)
+				argv.push_back(argument.c_str());
+			argv.push_back("-working-directory");
+			argv.push_back(command.directory.c_str());
+			return argv;
+		}
+
+		bool parseCompileCommand(Registry &registry, clang::Session &session, const CompileCommand &command, const std::string &pchFilename, clang::Parameters &parameters)
+		{
+			auto argv = getArguments(command);
+
+			size_t argc = argv.size();
+			if (!pchFilename.empty())
+			{
+				argv.push_back("-include-pch");
+				argv.push_back(pchFilename.c_str());
+			}
+
+			CXIndex index = session.acquireIndex();
+			if (!index)
+				return false;
+
+			Stats::Clock::duration parseDuration;
+			CXTranslationUnit translationUnit = parseCachedTranslationUnit(session, index, command.filename, argv.data(), (int)argv.size(), getParseOptions(parameters), parameters.stats, parseDuration);
+
+			// failing to parse is treated as a rejection of the precompiled header too
+			if (!pchFilename.empty() && (!translationUnit || hasPCHErrors(translationUnit)))
+			{
+				if (translationUnit)
+					clang_disposeTranslationUnit(translationUnit);
+				translationUnit = parseCachedTranslationUnit(session, index, command.filename, argv.data(), (int)argc, getParseOptions(parameters), parameters.stats, parseDuration);
+			}
+
+			if (translationUnit)
+			{
+				visitTranslationUnit(registry, translationUnit, parameters, parseDuration);
+				clang_disposeTranslationUnit(translationUnit);
+			}
+			session.releaseIndex(index);
+
+			return translationUnit != nullptr;
+		}
+
+		// calls the function with each index from 0 to count, on jobCount threads including the current one
+		void runConcurrently(size_t count, uint32_t jobCount, const std::function<void(size_t)> &function)
+		{
+			if (!jobCount)
+				jobCount = std::max(1u, std::thread::hardware_concurrency());
+			jobCount = (uint32_t)std::min<size_t>(jobCount, count);
+
+			std::atomic<size_t> next(0);
+			auto work = [&]
+			{
+				for (size_t i = next++; i < count; i = next++)
+					function(i);
+			};
+
+			std::vector<std::thread> workers;
+			for (uint32_t i = 1; i < jobCount; ++i)
+				workers.push_back(std::thread(work));
+			work();
+			for (auto &worker : workers)
+				worker.join();
+		}
+
+		struct FileSize
+		{
+			uint64_t lineCount;
+			uint64_t tokenCount;
+		};
+
+		// Shared by the threads measuring translation units.
+		class HeaderCostAccumulator
+		{
+		public:
+			// measured once, by the first translation unit including the file
+			FileSize getFileSize(const std::string &filename, const CXTranslationUnit translationUnit, CXFile file)
+			{
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					auto it = _fileSizes.find(filename);
+					if (it != _fileSizes.end())
+						return it->second;
+				}
+
+				FileSize size = { 0, 0 };
+				uint64_t byteCount = 0;
+				{
+					std::ifstream stream(filename, std::ios::binary);
+					char buffer[4096];
+					while (stream.read(buffer, sizeof(buffer)) || stream.gcount())
+					{
+						size.lineCount += std::count(buffer, buffer + stream.gcount(), '\n');
+						byteCount += stream.gcount();
+					}
+				}
+
+				if (byteCount)
+				{
+					CXSourceRange range = clang_getRange(clang_getLocationForOffset(translationUnit, file, 0),
+						clang_getLocationForOffset(translationUnit, file, (unsigned)byteCount));
+
+					CXToken *tokens;
+					unsigned tokenCount;
+					clang_tokenize(translationUnit, range, &tokens, &tokenCount);
+					clang_disposeTokens(translationUnit, tokens, tokenCount);
+					size.tokenCount = tokenCount;
+				}
+
+				std::lock_guard<std::mutex> lock(_mutex);
+				_fileSizes[filename] = size;
+				return size;
+			}
+
+			void add(const HeaderCosts &costs)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				for (auto &cost : costs)
+				{
+					auto it = _costs.find(cost.filename);
+					if (it == _costs.end())
+					{
+						_costs[cost.filename] = cost;
+						continue;
+					}
+
+					it->second.inclusionCount += cost.inclusionCount;
+					it->second.selfSeconds += cost.selfSeconds;
+					it->second.inclusiveSeconds += cost.inclusiveSeconds;
+				}
+			}
+
+			HeaderCosts getCosts() const
+			{
+				HeaderCosts costs;
+				for (auto &pair : _costs)
+					costs.push_back(pair.second);
+
+				std::sort(costs.begin(), costs.end(), [](const HeaderCost &a, const HeaderCost &b)
+				{
+					if (a.inclusiveSeconds != b.inclusiveSeconds)
+						return a.inclusiveSeconds > b.inclusiveSeconds;
+					return a.filename < b.filename;
+				});
+				return costs;
+			}
+
+		private:
+			std::mutex _mutex;
+			std::unordered_map<std::string, FileSize> _fileSizes;
+			std::unordered_map<std::string, HeaderCost> _costs;
+		};
+
+		struct InclusionEntry
+		{
+			CXFile file;
+			CXFile includingFile; // null for the main file
+		};
+
+		void inclusionCollector(CXFile includedFile, CXSourceLocation *inclusionStack, unsigned inclusionDepth, CXClientData clientData)
+		{
+			auto &entries = *static_cast<std::vector<InclusionEntry> *>(clientData);
+
+			InclusionEntry entry;
+			entry.file = includedFile;
+			entry.includingFile = nullptr;
+			if (inclusionDepth)
+				clang_getExpansionLocation(inclusionStack[0], &entry.includingFile, nullptr, nullptr, nullptr);
+			entries.push_back(entry);
+		}
+
+		void measureTranslationUnit(HeaderCostAccumulator &accumulator, const CXTranslationUnit translationUnit, double parseSeconds, const clang::Parameters &parameters)
+		{
+			// files come after the file including them
+			std::vector<InclusionEntry> entries;
+			clang_getInclusions(translationUnit, inclusionCollector, &entries);
+
+			struct FileCost
+			{
+				std::string filename; // empty if not reported
+				FileSize size;
+				uint64_t inclusiveTokenCount;
+				size_t firstEntry; // only the first inclusion brings the file into the translation unit
+			};
+
+			ExternalFilter externalFilter(parameters.externalDirectories);
+
+			// a header without guards is lexed at each inclusion, but counted once
+			std::vector<FileCost> fileCosts;
+			std::unordered_map<CXFile, size_t> fileIndices;
+			std::vector<size_t> fileIndicesByEntry; // -1 for invalid files
+			std::vector<size_t> includingIndices; // per entry, -1 for the main file
+			uint64_t totalTokenCount = 0;
+			for (auto &entry : entries)
+			{
+				auto itFile = entry.file ? fileIndices.find(entry.file) : fileIndices.end();
+				fileIndicesByEntry.push_back(itFile != fileIndices.end() ? itFile->second : (size_t)-1);
+
+				auto itIncluding = entry.includingFile ? fileIndices.find(entry.includingFile) : fileIndices.end();
+				includingIndices.push_back(itIncluding != fileIndices.end() ? itIncluding->second : (size_t)-1);
+
+				if (!entry.file || fileIndices.count(entry.file))
+					continue;
+
+				std::string filename = ClangString(clang_getFileName(entry.file)).str();
+				util::absolutePath(filename);
+
+				FileCost fileCost;
+				fileCost.size = accumulator.getFileSize(filename, translationUnit, entry.file);
+				fileCost.inclusiveTokenCount = 0;
+				fileCost.firstEntry = fileIndicesByEntry.size() - 1;
+				totalTokenCount += fileCost.size.tokenCount;
+
+				bool reported = entry.includingFile
+					&& (!parameters.pruneExternal || !externalFilter.isExternal(clang_getLocation(translationUnit, entry.file, 1, 1)))
+					&& (!parameters.filter || parameters.filter(filename));
+				if (reported)
+					fileCost.filename = filename;
+
+				fileIndicesByEntry.back() = fileCosts.size();
+				fileIndices[entry.file] = fileCosts.size();
+				fileCosts.push_back(fileCost);
+			}
+
+			if (!totalTokenCount)
+				return;
+
+			// backwards, so that the files included by a file are summed before it
+			for (size_t i = entries.size(); i-- > 0;)
+			{
+				size_t fileIndex = fileIndicesByEntry[i];
+				if (fileIndex == (size_t)-1 || fileCosts[fileIndex].firstEntry != i)
+					continue;
+
+				auto &fileCost = fileCosts[fileIndex];
+				fileCost.inclusiveTokenCount += fileCost.size.tokenCount;
+				if (includingIndices[i] != (size_t)-1 && includingIndices[i] != fileIndex)
+					fileCosts[includingIndices[i]].inclusiveTokenCount += fileCost.inclusiveTokenCount;
+			}
+
+			double secondsPerToken = parseSeconds / totalTokenCount;
+
+			HeaderCosts costs;
+			for (auto &fileCost : fileCosts)
+			{
+				if (fileCost.filename.empty())
+					continue;
+
+				HeaderCost cost;
+				cost.filename = fileCost.filename;
+				cost.inclusionCount = 1;
+				cost.lineCount = fileCost.size.lineCount;
+				cost.tokenCount = fileCost.size.tokenCount;
+				cost.selfSeconds = fileCost.size.tokenCount * secondsPerToken;
+				cost.inclusiveSeconds = fileCost.inclusiveTokenCount * secondsPerToken;
+				costs.push_back(cost);
+			}
+			accumulator.add(costs);
+		}
+
+		bool measureCompileCommand(HeaderCostAccumulator &accumulator, clang::Session &session, const CompileCommand &command, clang::Parameters &parameters)
+		{
+			auto argv = getArguments(command);
+
+			CXIndex index = session.acquireIndex();
+			if (!index)
+				return false;
+
+			Stats::Clock::duration parseDuration;
+			CXTranslationUnit translationUnit = parseTranslationUnit(index, 0, argv.data(), (int)argv.size(), CXTranslationUnit_None, parameters.stats, parseDuration);
+			if (translationUnit)
+			{
+				ScopedTimer timer(parameters.stats, "cost");
+				measureTranslationUnit(accumulator, translationUnit, std::chrono::duration<double>(parseDuration).count(), parameters);
+				clang_disposeTranslationUnit(translationUnit);
+			}
+			session.releaseIndex(index);
+
+			return translationUnit != nullptr;
+		}
+
+		bool measureCompileCommands(HeaderCosts &costs, clang::Session &session, const std::vector<CompileCommand> &commands, uint32_t jobCount, clang::Parameters &parameters)
+		{
+			HeaderCostAccumulator accumulator;
+			std::atomic<bool> succeeded(true);
+			runConcurrently(commands.size(), jobCount, [&](size_t i)
+			{
+				if (!measureCompileCommand(accumulator, session, commands[i], parameters))
+					succeeded = false;
+			});
+
+			costs = accumulator.getCosts();
+			return succeeded;
+		}
 	}
 
 	namespace clang
 	{
 		Parameters::Parameters()
 			: filter(nullptr)
+			, stats(nullptr)
+			, pruneExternal(false)
+			, includeGraph(false)
+		{}
+
+		CompilationDatabaseParameters::CompilationDatabaseParameters()
+			: jobCount(0)
+			, sharedPCH(false)
+		{}
+
+		SessionParameters::SessionParameters()
+			: excludeDeclarationsFromPCH(false)
+			, displayDiagnostics(false)
+		{}
+
+		Session::Session(const SessionParameters &parameters)
+			: _parameters(parameters)
 		{}
 
+		Session::~Session()
+		{
+			for (auto index : _indices)
+				clang_disposeIndex(index);
+		}
+
+		const SessionParameters &Session::getParameters() const
+		{
+			return _parameters;
+		}
+
+		CXIndex Session::acquireIndex()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (!_freeIndices.empty())
+				{
+					CXIndex index = _freeIndices.back();
+					_freeIndices.pop_back();
+					return index;
+				}
+			}
+
+			// creating an index takes time, not under the lock
+			CXIndex index = clang_createIndex(_parameters.excludeDeclarationsFromPCH, _parameters.displayDiagnostics);
+			if (!index)
+				return nullptr;
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			_indices.push_back(index);
+			return index;
+		}
+
+		void Session::releaseIndex(CXIndex index)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_freeIndices.push_back(index);
+		}
+
 		DirectoryFilter::DirectoryFilter()
 		{
 			util::currentWorkingDirectory(_path);
@@ -498,39 +1547,127 @@ namespace architect
 
 		void parse(Registry &registry, const CXTranslationUnit translationUnit, Parameters &parameters)
 		{
-			CXCursor rootCursor = clang_getTranslationUnitCursor(translationUnit);
+			visitTranslationUnit(registry, translationUnit, parameters, Stats::Clock::duration::zero());
+		}
 
-#ifdef ARCHITECT_CLANG_PRINT_CURSORS
-			std::string prefix;
-			clang_visitChildren(rootCursor, printCursorsVisitor, &prefix);
-#endif
+		bool parse(Registry &registry, Session &session, int argc, const char *const *argv, Parameters &parameters)
+		{
+			CXIndex index = session.acquireIndex();
+			if (!index)
+			{
+				return false;
+			}
+
+			std::string sourceFilename = findSourceFile(argv, argc);
+			if (!sourceFilename.empty())
+				util::absolutePath(sourceFilename);
+
+			Stats::Clock::duration parseDuration;
+			CXTranslationUnit translationUnit = parseCachedTranslationUnit(session, index, sourceFilename, argv, argc, getParseOptions(parameters), parameters.stats, parseDuration);
+			if (!translationUnit)
+			{
+				session.releaseIndex(index);
+				return false;
+			}
+
+			visitTranslationUnit(registry, translationUnit, parameters, parseDuration);
+
+			clang_disposeTranslationUnit(translationUnit);
+			session.releaseIndex(index);
 
-			VisitorContext context(&registry, parameters);
-			clang_visitChildren(rootCursor, globalVisitor, &context);
+			return true;
 		}
 
 		bool parse(Registry &registry, int argc, const char *const *argv, Parameters &parameters)
 		{
-			CXIndex index = clang_createIndex(0, 0);
+			Session session;
+			return parse(registry, session, argc, argv, parameters);
+		}
+
+		bool load(Registry &registry, Session &session, const std::string &astFilename, Parameters &parameters)
+		{
+			CXIndex index = session.acquireIndex();
 			if (!index)
-			{
 				return false;
-			}
 
-			CXTranslationUnit translationUnit = clang_parseTranslationUnit(index, 0,
-				argv, argc, 0, 0, CXTranslationUnit_None);
+			Stats::Clock::duration loadDuration;
+			CXTranslationUnit translationUnit = loadTranslationUnit(index, astFilename, parameters.stats, loadDuration);
 			if (!translationUnit)
 			{
+				session.releaseIndex(index);
 				return false;
 			}
 
-			parse(registry, translationUnit, parameters);
+			visitTranslationUnit(registry, translationUnit, parameters, loadDuration);
 
 			clang_disposeTranslationUnit(translationUnit);
-			clang_disposeIndex(index);
+			session.releaseIndex(index);
 
 			return true;
 		}
+
+		bool parseCompilationDatabase(Registry &registry, Session &session, const std::string &buildDirectory, const CompilationDatabaseParameters &databaseParameters, Parameters &parameters)
+		{
+			std::vector<CompileCommand> commands;
+			if (!loadCompileCommands(buildDirectory, commands))
+				return false;
+			if (commands.empty())
+				return true;
+
+			// cached translation units would refer to the precompiled header once deleted
+			std::string headerFilename, pchFilename;
+			if (databaseParameters.sharedPCH && session.getParameters().astCacheDirectory.empty())
+			{
+				auto includes = computeCommonIncludes(commands);
+				std::string directory = databaseParameters.pchDirectory;
+				if (!includes.empty() && (!directory.empty() || util::temporaryDirectory(directory)))
+				{
+					// unique, so that concurrent runs do not overwrite each other's
+					static std::atomic<uint32_t> nextPCHIndex(0);
+					std::ostringstream filename;
+					filename << directory << "/architect-" << util::processId() << "-" << nextPCHIndex++ << ".hpp";
+					headerFilename = filename.str();
+
+					pchFilename = buildPCH(registry, session, commands, includes, headerFilename, parameters);
+				}
+			}
+
+			std::atomic<bool> succeeded(true);
+			runConcurrently(commands.size(), databaseParameters.jobCount, [&](size_t i)
+			{
+				if (!parseCompileCommand(registry, session, commands[i], pchFilename, parameters))
+					succeeded = false;
+			});
+
+			// also after a failed build, which may have left either file
+			if (!headerFilename.empty())
+			{
+				std::remove(headerFilename.c_str());
+				std::remove((headerFilename + ".pch").c_str());
+			}
+
+			return succeeded;
+		}
+
+		bool computeHeaderCosts(HeaderCosts &costs, Session &session, const std::string &buildDirectory, const CompilationDatabaseParameters &databaseParameters, Parameters &parameters)
+		{
+			std::vector<CompileCommand> commands;
+			if (!loadCompileCommands(buildDirectory, commands))
+				return false;
+
+			return measureCompileCommands(costs, session, commands, databaseParameters.jobCount, parameters);
+		}
+
+		bool computeHeaderCosts(HeaderCosts &costs, Session &session, int argc, const char *const *argv, Parameters &parameters)
+		{
+			// the arguments are given to clang as for parse
+			std::vector<CompileCommand> commands(1);
+			auto &command = commands.front();
+			util::currentWorkingDirectory(command.directory);
+			command.arguments.assign(argv, argv + argc);
+
+			return measureCompileCommands(costs, session, commands, 1, parameters);
+		}
 	}
 }
 
@@ -1,6 +1,7 @@
 #ifdef ARCHITECT_CONSOLE_SUPPORT
 #include <architect/console.hpp>
 
+#include <algorithm>
 #include <architect/Registry.hpp>
 
 namespace architect
@@ -19,6 +20,8 @@ namespace architect
 				return "composition";
 			case ReferenceType::ASSOCIATION:
 				return "association";
+			case ReferenceType::INCLUSION:
+				return "inclusion";
 			default:
 				return "???";
 			}
@@ -38,39 +41,137 @@ namespace architect
 				return "record template";
 			case SymbolType::TYPEDEF:
 				return "typedef";
+			case SymbolType::EXTERNAL:
+				return "external";
+			case SymbolType::FILE:
+				return "file";
 			default:
 				return "???";
 			}
 		}
+
+		// reuses its buffer, so that formatting does not allocate once the buffer is large enough
+		class NameFormatter
+		{
+		public:
+			const std::string &operator()(const Symbol *symbol)
+			{
+				_buffer.clear();
+				symbol->appendFullName(_buffer);
+				return _buffer;
+			}
+
+		private:
+			std::string _buffer;
+		};
 	}
 
 	namespace console
 	{
 		void dumpCycles(const Cycles &cycles, std::ostream &stream)
 		{
+			NameFormatter name;
+
 			for (auto &cycle : cycles)
 			{
 				stream << "- ";
 				for (auto symbol : cycle)
 				{
-					stream << symbol->getFullName() << " -> ";
+					stream << name(symbol) << " -> ";
 				}
 
-				stream << (*cycle.begin())->getFullName() << "\n";
+				stream << name(*cycle.begin()) << "\n";
+			}
+		}
+
+		void dumpDiff(const Diff &diff, std::ostream &stream)
+		{
+			NameFormatter fromName, toName;
+
+			for (auto symbol : diff.addedSymbols)
+				stream << "+ " << fromName(symbol) << " (" << getSymbolTypeName(symbol->type) << ")\n";
+
+			for (auto symbol : diff.removedSymbols)
+				stream << "- " << fromName(symbol) << " (" << getSymbolTypeName(symbol->type) << ")\n";
+
+			for (auto &edge : diff.addedEdges)
+				stream << "+ " << fromName(edge.from) << " -> " << toName(edge.to) << " (" << getReferenceTypeName(edge.type) << ")\n";
+
+			for (auto &edge : diff.removedEdges)
+				stream << "- " << fromName(edge.from) << " -> " << toName(edge.to) << " (" << getReferenceTypeName(edge.type) << ")\n";
+
+			for (auto &edge : diff.changedEdges)
+				stream << "~ " << fromName(edge.from) << " -> " << toName(edge.to) << " (" << getReferenceTypeName(edge.previousType) << " -> " << getReferenceTypeName(edge.type) << ")\n";
+		}
+
+		void dumpHeaderCosts(const HeaderCosts &costs, std::ostream &stream)
+		{
+			for (auto &cost : costs)
+			{
+				stream << cost.filename << ": " << cost.inclusiveSeconds * 1000. << " ms inclusive, " << cost.selfSeconds * 1000. << " ms self"
+					<< ", included by " << cost.inclusionCount << " translation units"
+					<< ", " << cost.tokenCount << " tokens, " << cost.lineCount << " lines\n";
+			}
+		}
+
+		void dumpStats(const Stats &stats, std::ostream &stream)
+		{
+			for (auto &phase : stats.getPhases())
+			{
+				double milliseconds = std::chrono::duration<double, std::milli>(phase.duration).count();
+				stream << phase.name << ": " << milliseconds << " ms";
+				if (phase.count > 1)
+					stream << " (" << phase.count << " times)";
+				stream << "\n";
+			}
+
+			for (auto &pair : stats.getCounters())
+				stream << pair.first << ": " << pair.second << "\n";
+
+			auto translationUnits = stats.getTranslationUnits();
+			if (translationUnits.empty())
+				return;
+
+			const double megabyte = 1024. * 1024.;
+
+			stream << "\ntranslation units, most memory first:\n";
+			for (auto &translationUnit : translationUnits)
+			{
+				stream << "  " << translationUnit.filename << ": " << translationUnit.totalMemory / megabyte << " MB"
+					<< ", parse " << std::chrono::duration<double, std::milli>(translationUnit.parseDuration).count() << " ms"
+					<< ", visit " << std::chrono::duration<double, std::milli>(translationUnit.visitDuration).count() << " ms"
+					<< ", " << translationUnit.cursorCount << " cursors\n";
 			}
+
+			auto memory = stats.getTranslationUnitMemory();
+			std::vector<std::pair<std::string, uint64_t>> categories(memory.begin(), memory.end());
+			std::stable_sort(categories.begin(), categories.end(), [](const std::pair<std::string, uint64_t> &a, const std::pair<std::string, uint64_t> &b)
+			{
+				return a.second > b.second;
+			});
+
+			stream << "\nmemory of translation units, by category:\n";
+			for (auto &pair : categories)
+				stream << "  " << pair.first << ": " << pair.second / megabyte << " MB\n";
 		}
 
 		void dumpSymbols(const Symbols &symbols, std::ostream &stream)
 		{
+			NameFormatter name;
+
 			for (auto &pair : symbols)
 			{
 				const Symbol *symbol = pair.second;
 
-				stream << symbol->getFullName() << " (" << getSymbolTypeName(symbol->type) << ")\n";
+				stream << name(symbol) << " (" << getSymbolTypeName(symbol->type) << ")\n";
 
 				for (auto &refPair : symbol->references)
 				{
-					stream << "  " << symbols.at(refPair.first)->getFullName() << "\n";
+					auto it = symbols.find(refPair.first);
+					if (it == symbols.end())
+						continue;
+
+					stream << "  " << name(it->second) << "\n";
 
 					for (auto &reference : refPair.second)
 					{
@@ -1,7 +1,13 @@
 #ifdef ARCHITECT_DOT_SUPPORT
 #include <architect/dot.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <architect/Fingerprint.hpp>
 #include <architect/Registry.hpp>
 
 namespace architect
@@ -10,114 +16,515 @@ namespace architect
 	{
 		namespace
 		{
-			class Attributes
+			// Fixed-size buffer, written to the stream in bulk.
+			class Writer
 			{
 			public:
-				template <typename T>
-				void insert(std::string key, T value)
+				Writer(std::ostream &stream, const FormattingParameters &parameters)
+					: _stream(stream)
+					, _buffer(new char[capacity])
+					, _size(0)
+					, _depth(0)
+					, _pretty(parameters.pretty)
+				{}
+
+				~Writer()
 				{
-					insert(key, std::to_string(value));
+					flush();
 				}
 
-				template <>
-				void insert(std::string key, const char *value)
+				Writer &operator<<(char c)
 				{
-					insert(key, std::string(value));
+					if (_size == capacity)
+						flush();
+					_buffer[_size++] = c;
+					return *this;
 				}
 
-				template <>
-				void insert(std::string key, std::string value)
+				Writer &operator<<(const char *str)
 				{
-					auto it = _map.find(key);
-					if (it == _map.end())
-						_map.insert(std::pair<std::string, std::string>(key, value));
-					else
-						it->second += "," + value;
+					write(str, strlen(str));
+					return *this;
+				}
+
+				Writer &operator<<(const std::string &str)
+				{
+					write(str.data(), str.size());
+					return *this;
+				}
+
+				Writer &operator<<(unsigned int value)
+				{
+					writeNumber(value);
+					return *this;
+				}
+
+				Writer &operator<<(unsigned long value)
+				{
+					writeNumber(value);
+					return *this;
+				}
+
+				Writer &operator<<(unsigned long long value)
+				{
+					writeNumber(value);
+					return *this;
+				}
+
+				void beginStatement()
+				{
+					if (_pretty)
+					{
+						for (uint32_t i = 0; i <= _depth; ++i)
+							write("  ", 2);
+					}
+				}
+
+				void beginBlock()
+				{
+					beginStatement();
+					++_depth;
+				}
+
+				void endBlock()
+				{
+					--_depth;
+					beginStatement();
+					*this << '}';
+					if (_pretty)
+						*this << '\n';
+				}
+
+				void endStatement()
+				{
+					*this << ';';
+					if (_pretty)
+						*this << '\n';
+				}
+
+				// for text between quotes, e.g. file paths with backslashes in the include graph
+				void writeEscaped(const std::string &text)
+				{
+					size_t begin = 0;
+					for (size_t i = 0; i < text.size(); ++i)
+					{
+						if (text[i] == '\\' || text[i] == '"')
+						{
+							write(&text[begin], i - begin);
+							*this << '\\' << text[i];
+							begin = i + 1;
+						}
+					}
+					write(&text[begin], text.size() - begin);
+				}
+
+				void write(const char *data, size_t size)
+				{
+					if (_size + size > capacity)
+					{
+						flush();
+						if (size > capacity)
+						{
+							_stream.write(data, size);
+							return;
+						}
+					}
+
+					memcpy(&_buffer[_size], data, size);
+					_size += size;
+				}
+
+				void flush()
+				{
+					_stream.write(_buffer.get(), _size);
+					_size = 0;
 				}
 
 			private:
-				std::map<std::string, std::string> _map;
-				friend std::ostream &operator<<(std::ostream &stream, const Attributes &attributes);
+				static const size_t capacity = 1 << 16;
+
+				void writeNumber(unsigned long long value)
+				{
+					char digits[20];
+					size_t count = 0;
+					do
+					{
+						digits[sizeof(digits) - ++count] = (char)('0' + value % 10);
+						value /= 10;
+					} while (value);
+					write(&digits[sizeof(digits) - count], count);
+				}
+
+				std::ostream &_stream;
+				std::unique_ptr<char[]> _buffer;
+				size_t _size;
+				uint32_t _depth;
+				bool _pretty;
 			};
 
-			std::ostream &operator<<(std::ostream &stream, const Attributes &attributes)
+			// attributes following the label, with keys sorted as they used to be
+			const char *getSymbolAttributes(SymbolType type, bool defined)
 			{
-				if (!attributes._map.empty())
+				switch (type)
 				{
-					stream << "[";
-					for (auto &pair : attributes._map)
-					{
-						stream << pair.first << "=\"" << pair.second << "\";";
-					}
-					stream << "]";
+				case SymbolType::GLOBAL:
+					return defined ? "shape=\"ellipse\";" : "shape=\"ellipse\";style=\"dashed\";";
+				case SymbolType::GLOBAL_TEMPLATE:
+					return defined ? "shape=\"ellipse\";style=\"diagonals\";" : "shape=\"ellipse\";style=\"diagonals,dashed\";";
+				case SymbolType::RECORD:
+					return defined ? "shape=\"box\";" : "shape=\"box\";style=\"dashed\";";
+				case SymbolType::RECORD_TEMPLATE:
+					return defined ? "shape=\"box\";style=\"diagonals\";" : "shape=\"box\";style=\"diagonals,dashed\";";
+				case SymbolType::TYPEDEF:
+					return defined ? "shape=\"octagon\";" : "shape=\"octagon\";style=\"dashed\";";
+				case SymbolType::EXTERNAL:
+					return "shape=\"box\";style=\"dotted\";";
+				case SymbolType::FILE:
+					return "shape=\"note\";";
+				default:
+					return defined ? "" : "style=\"dashed\";";
 				}
-				return stream;
 			}
 
-			void outputSymbol(const Symbol *symbol, std::ostream &stream, const FormattingParameters &parameters)
+			const char *getReferenceAttributes(ReferenceType type)
+			{
+				switch (type)
+				{
+				case ReferenceType::TEMPLATE:
+					return "arrowtail=\"invempty\";dir=\"both\";";
+				case ReferenceType::INHERITANCE:
+					return "arrowhead=\"empty\";";
+				case ReferenceType::COMPOSITION:
+					return "arrowtail=\"diamond\";dir=\"both\";";
+				case ReferenceType::INCLUSION:
+					return "style=\"dashed\";";
+				default:
+					return "";
+				}
+			}
+
+			template <typename Id>
+			void outputNode(Writer &writer, const Id &nodeId, const Symbol *symbol, std::string &name, const char *extraAttributes = "")
+			{
+				name.clear();
+				symbol->appendFullName(name);
+
+				writer.beginStatement();
+				writer << nodeId << "[label=\"";
+				writer.writeEscaped(name);
+				writer << "\";" << getSymbolAttributes(symbol->type, symbol->defined) << extraAttributes << ']';
+				writer.endStatement();
+			}
+
+			void outputEdge(Writer &writer, size_t fromId, size_t toId)
 			{
-				Attributes attributes;
+				writer.beginStatement();
+				writer << fromId << "->" << toId;
+				writer.endStatement();
+			}
 
-				attributes.insert("label", symbol->getFullName());
+			template <typename Id>
+			void outputEdge(Writer &writer, const Id &fromId, const Id &toId, ReferenceType type, size_t referenceCount, const char *extraAttributes = "")
+			{
+				const char *attributes = getReferenceAttributes(type);
 
-				switch (symbol->type)
+				writer.beginStatement();
+				writer << fromId << "->" << toId;
+				if (*attributes || referenceCount || *extraAttributes)
 				{
-				case SymbolType::GLOBAL:
-					attributes.insert("shape", "ellipse");
-					break;
+					writer << '[' << attributes;
+					if (referenceCount)
+						writer << "label=\"" << referenceCount << "\";";
+					writer << extraAttributes << ']';
+				}
+				writer.endStatement();
+			}
 
-				case SymbolType::GLOBAL_TEMPLATE:
-					attributes.insert("shape", "ellipse");
-					attributes.insert("style", "diagonals");
-					break;
+			void beginGraph(Writer &writer, const FormattingParameters &parameters)
+			{
+				writer << "strict digraph{";
+				if (parameters.pretty)
+					writer << '\n';
+			}
 
-				case SymbolType::RECORD:
-					attributes.insert("shape", "box");
-					break;
+			void endGraph(Writer &writer)
+			{
+				writer << "}\n";
+			}
 
-				case SymbolType::RECORD_TEMPLATE:
-					attributes.insert("shape", "box");
-					attributes.insert("style", "diagonals");
-					break;
+			// symbol, or namespace collapsing several symbols
+			struct ClusterNode
+			{
+				const Symbol *symbol;
+				const Namespace *ns;
+				size_t symbolCount;
+				std::string label;
+				std::string id;
+				size_t order;
+			};
 
-				case SymbolType::TYPEDEF:
-					attributes.insert("shape", "octagon");
-					break;
+			struct ClusterEdge
+			{
+				size_t from, to;
+				ReferenceType type;
+				size_t referenceCount;
+			};
+
+			const Namespace *getCollapsedNamespace(const Namespace *ns, int32_t collapseDepth)
+			{
+				if (collapseDepth < 0)
+					return nullptr;
+
+				uint32_t depth = 0;
+				for (auto iterNs = ns; iterNs->parent; iterNs = iterNs->parent)
+					++depth;
+
+				if (depth <= (uint32_t)collapseDepth)
+					return nullptr;
+
+				for (; depth > (uint32_t)collapseDepth + 1; --depth)
+					ns = ns->parent;
+				return ns;
+			}
+
+			// Writes nodes in a deterministic order, nested in the clusters of their namespaces.
+			class ClusterWriter
+			{
+			public:
+				ClusterWriter(Writer &writer, std::vector<ClusterNode> &nodes, const FormattingParameters &parameters)
+					: _writer(writer)
+					, _nodes(nodes)
+					, _parameters(parameters)
+					, _order(0)
+					, _clusterCount(0)
+				{
+					for (size_t index = 0; index < _nodes.size(); ++index)
+					{
+						const Namespace *container = _nodes[index].symbol ? _nodes[index].ns : _nodes[index].ns->parent;
+						_containedNodes[container].push_back(index);
+
+						for (; container && _usedNamespaces.insert(container).second; container = container->parent)
+							;
+					}
+
+					for (auto &pair : _containedNodes)
+					{
+						std::sort(pair.second.begin(), pair.second.end(), [this](size_t a, size_t b)
+						{
+							return _nodes[a].label < _nodes[b].label;
+						});
+					}
 				}
 
-				if (!symbol->defined)
-					attributes.insert("style", "dashed");
+				void writeNamespace(const Namespace *ns, bool cluster)
+				{
+					if (cluster)
+					{
+						_writer.beginBlock();
+						_writer << "subgraph cluster_";
+						if (_parameters.stableIds)
+							_writer << FingerprintBuilder().add("namespace").add(ns->qualifiedName).get().toString();
+						else
+							_writer << _clusterCount++;
+						_writer << "{label=\"";
+						_writer.writeEscaped(ns->name == StringPool::empty ? "?" : ns->getName());
+						_writer << "\";";
+						if (_parameters.pretty)
+							_writer << '\n';
+					}
 
-				if (parameters.pretty)
-					stream << "  ";
-				stream << symbol->id << attributes << ";";
-				if (parameters.pretty)
-					stream << "\n";
+					auto it = _containedNodes.find(ns);
+					if (it != _containedNodes.end())
+					{
+						for (auto index : it->second)
+							writeNode(_nodes[index]);
+					}
+
+					std::vector<const Namespace *> children;
+					for (auto &pair : ns->children)
+					{
+						if (_usedNamespaces.find(pair.second) != _usedNamespaces.end())
+							children.push_back(pair.second);
+					}
+
+					std::sort(children.begin(), children.end(), [](const Namespace *a, const Namespace *b)
+					{
+						return a->qualifiedName < b->qualifiedName;
+					});
+
+					for (auto child : children)
+						writeNamespace(child, _parameters.clusterNamespaces);
+
+					if (cluster)
+						_writer.endBlock();
+				}
+
+			private:
+				void writeNode(ClusterNode &node)
+				{
+					node.order = _order++;
+					if (_parameters.stableIds)
+					{
+						Fingerprint fingerprint = node.symbol ? node.symbol->computeIdentityFingerprint() : FingerprintBuilder().add("namespace").add(node.ns->qualifiedName).get();
+						node.id = 'n';
+						node.id += fingerprint.toString();
+					}
+					else
+					{
+						node.id = std::to_string(node.order);
+					}
+
+					if (node.symbol)
+					{
+						outputNode(_writer, node.id, node.symbol, _name);
+						return;
+					}
+
+					_writer.beginStatement();
+					_writer << node.id << "[label=\"";
+					_writer.writeEscaped(node.label);
+					_writer << "\\n" << node.symbolCount << " symbols\";shape=\"folder\";]";
+					_writer.endStatement();
+				}
+
+				Writer &_writer;
+				std::vector<ClusterNode> &_nodes;
+				const FormattingParameters &_parameters;
+				std::unordered_map<const Namespace *, std::vector<size_t>> _containedNodes;
+				std::unordered_set<const Namespace *> _usedNamespaces;
+				std::string _name;
+				size_t _order;
+				size_t _clusterCount;
+			};
+
+			void dumpClusteredSymbols(const Symbols &symbols, Writer &writer, const FormattingParameters &parameters)
+			{
+				std::vector<ClusterNode> nodes;
+				std::unordered_map<SymbolId, size_t> symbolNodes;
+				std::unordered_map<const Namespace *, size_t> namespaceNodes;
+				const Namespace *rootNs = nullptr;
+
+				for (auto &pair : symbols)
+				{
+					const Symbol *symbol = pair.second;
+
+					if (!rootNs)
+					{
+						for (rootNs = symbol->ns; rootNs->parent; rootNs = rootNs->parent)
+							;
+					}
+
+					const Namespace *collapsedNs = getCollapsedNamespace(symbol->ns, parameters.collapseDepth);
+					if (collapsedNs)
+					{
+						auto result = namespaceNodes.insert(std::make_pair(collapsedNs, nodes.size()));
+						if (result.second)
+						{
+							ClusterNode node;
+							node.symbol = nullptr;
+							node.ns = collapsedNs;
+							node.symbolCount = 0;
+							node.label = collapsedNs->qualifiedName;
+							nodes.push_back(node);
+						}
+
+						++nodes[result.first->second].symbolCount;
+						symbolNodes.insert(std::make_pair(pair.first, result.first->second));
+						continue;
+					}
+
+					symbolNodes.insert(std::make_pair(pair.first, nodes.size()));
+
+					ClusterNode node;
+					node.symbol = symbol;
+					node.ns = symbol->ns;
+					node.symbolCount = 1;
+					symbol->appendFullName(node.label);
+					nodes.push_back(node);
+				}
+
+				if (!rootNs)
+					return;
+
+				ClusterWriter clusterWriter(writer, nodes, parameters);
+				clusterWriter.writeNamespace(rootNs, false);
+
+				// references between the same nodes are aggregated, keeping the most important type
+				std::vector<ClusterEdge> edges;
+				std::unordered_map<uint64_t, size_t> edgeIndices;
+				for (auto &pair : symbols)
+				{
+					size_t from = symbolNodes.at(pair.first);
+					for (auto &refPair : pair.second->references)
+					{
+						auto it = symbolNodes.find(refPair.first);
+						if (it == symbolNodes.end())
+							continue;
+
+						size_t to = it->second;
+						if (from == to && !nodes[from].symbol)
+							continue;
+
+						auto &referenceSet = refPair.second;
+						uint64_t key = ((uint64_t)from << 32) | to;
+						auto result = edgeIndices.insert(std::make_pair(key, edges.size()));
+						if (result.second)
+						{
+							ClusterEdge edge;
+							edge.from = from;
+							edge.to = to;
+							edge.type = referenceSet.begin()->type;
+							edge.referenceCount = referenceSet.size();
+							edges.push_back(edge);
+						}
+						else
+						{
+							auto &edge = edges[result.first->second];
+							edge.type = std::min(edge.type, referenceSet.begin()->type);
+							edge.referenceCount += referenceSet.size();
+						}
+					}
+				}
+
+				std::sort(edges.begin(), edges.end(), [&nodes](const ClusterEdge &a, const ClusterEdge &b)
+				{
+					if (nodes[a.from].order != nodes[b.from].order)
+						return nodes[a.from].order < nodes[b.from].order;
+					return nodes[a.to].order < nodes[b.to].order;
+				});
+
+				for (auto &edge : edges)
+				{
+					// edges of collapsed namespaces always show how many references they stand for
+					bool aggregated = !nodes[edge.from].symbol || !nodes[edge.to].symbol;
+					size_t referenceCount = parameters.displayReferenceCount || aggregated ? edge.referenceCount : 0;
+					outputEdge(writer, nodes[edge.from].id, nodes[edge.to].id, edge.type, referenceCount);
+				}
 			}
 		}
 
 		FormattingParameters::FormattingParameters()
-			: displayReferenceCount(false)
+			: clusterNamespaces(false)
+			, collapseDepth(-1)
+			, displayReferenceCount(false)
 			, pretty(false)
+			, stableIds(false)
 		{}
 
 		void dumpCycles(const Cycles &cycles, std::ostream &stream, const FormattingParameters &parameters)
 		{
+			Writer writer(stream, parameters);
+			std::string name;
 			std::set<const Symbol *> visitedSymbols;
 
-			stream << "strict digraph{";
-			if (parameters.pretty)
-				stream << "\n";
+			beginGraph(writer, parameters);
 
 			for (auto &cycle : cycles)
 			{
 				for (auto symbol : cycle)
 				{
-					if (visitedSymbols.find(symbol) == visitedSymbols.end())
-					{
-						visitedSymbols.insert(symbol);
-						outputSymbol(symbol, stream, parameters);
-					}
+					if (visitedSymbols.insert(symbol).second)
+						outputNode(writer, symbol->id, symbol, name);
 				}
 			}
 
@@ -127,72 +534,108 @@ namespace architect
 
 				for (auto symbol : cycle)
 				{
-					if (parameters.pretty)
-						stream << "  ";
-					stream << previousId << "->" << symbol->id << ";";
-					if (parameters.pretty)
-						stream << "\n";
-					
+					outputEdge(writer, previousId, symbol->id);
 					previousId = symbol->id;
 				}
 			}
 
-			stream << "}\n";
+			endGraph(writer);
+		}
+
+		void dumpDiff(const Diff &diff, std::ostream &stream, const FormattingParameters &parameters)
+		{
+			Writer writer(stream, parameters);
+			std::string name;
+
+			// symbols come from two registries, so ids may collide
+			std::unordered_map<const Symbol *, size_t> nodeIds;
+			auto outputDiffNode = [&](const Symbol *symbol, const char *extraAttributes)
+			{
+				if (nodeIds.find(symbol) != nodeIds.end())
+					return;
+
+				size_t nodeId = nodeIds.size();
+				nodeIds.insert(std::make_pair(symbol, nodeId));
+				outputNode(writer, nodeId, symbol, name, extraAttributes);
+			};
+
+			beginGraph(writer, parameters);
+
+			for (auto symbol : diff.addedSymbols)
+				outputDiffNode(symbol, "color=\"green\";");
+
+			for (auto symbol : diff.removedSymbols)
+				outputDiffNode(symbol, "color=\"red\";");
+
+			// unchanged symbols, only shown as ends of changed edges
+			for (auto &edge : diff.addedEdges)
+			{
+				outputDiffNode(edge.from, "");
+				outputDiffNode(edge.to, "");
+			}
+
+			for (auto &edge : diff.removedEdges)
+			{
+				outputDiffNode(edge.from, "");
+				outputDiffNode(edge.to, "");
+			}
+
+			for (auto &edge : diff.changedEdges)
+			{
+				outputDiffNode(edge.from, "");
+				outputDiffNode(edge.to, "");
+			}
+
+			for (auto &edge : diff.addedEdges)
+				outputEdge(writer, nodeIds.at(edge.from), nodeIds.at(edge.to), edge.type, 0, "color=\"green\";");
+
+			for (auto &edge : diff.removedEdges)
+				outputEdge(writer, nodeIds.at(edge.from), nodeIds.at(edge.to), edge.type, 0, "color=\"red\";style=\"dashed\";");
+
+			for (auto &edge : diff.changedEdges)
+				outputEdge(writer, nodeIds.at(edge.from), nodeIds.at(edge.to), edge.type, 0, "color=\"orange\";");
+
+			endGraph(writer);
 		}
 
 		void dumpSymbols(const Symbols &symbols, std::ostream &stream, const FormattingParameters &parameters)
 		{
-			stream << "strict digraph{";
-			if (parameters.pretty)
-				stream << "\n";
+			Writer writer(stream, parameters);
+			std::string name;
+
+			beginGraph(writer, parameters);
+
+			if (parameters.clusterNamespaces || parameters.collapseDepth >= 0 || parameters.stableIds)
+			{
+				dumpClusteredSymbols(symbols, writer, parameters);
+				endGraph(writer);
+				return;
+			}
 
 			for (auto &pair : symbols)
 			{
 				const Symbol *symbol = pair.second;
-				outputSymbol(symbol, stream, parameters);
+				outputNode(writer, symbol->id, symbol, name);
 			}
 
 			for (auto &pair : symbols)
 			{
 				const Symbol *parent = pair.second;
 
-				for (auto &pair : parent->references)
+				for (auto &refPair : parent->references)
 				{
-					Symbol *child = symbols.at(pair.first);
-					auto &referenceSet = pair.second;
-					auto &mostImportantDep = *referenceSet.begin();
-
-					Attributes attributes;
-
-					if (parameters.displayReferenceCount)
-						attributes.insert("label", referenceSet.size());
+					if (symbols.find(refPair.first) == symbols.end())
+						continue;
 
-					switch (mostImportantDep.type)
-					{
-					case ReferenceType::TEMPLATE:
-						attributes.insert("arrowtail", "invempty");
-						attributes.insert("dir", "both");
-						break;
-
-					case ReferenceType::INHERITANCE:
-						attributes.insert("arrowhead", "empty");
-						break;
-
-					case ReferenceType::COMPOSITION:
-						attributes.insert("arrowtail", "diamond");
-						attributes.insert("dir", "both");
-						break;
-					}
+					auto &referenceSet = refPair.second;
+					auto &mostImportantDep = *referenceSet.begin();
 
-					if (parameters.pretty)
-						stream << "  ";
-					stream << parent->id << "->" << child->id << attributes << ";";
-					if (parameters.pretty)
-						stream << "\n";
+					size_t referenceCount = parameters.displayReferenceCount ? referenceSet.size() : 0;
+					outputEdge(writer, parent->id, refPair.first, mostImportantDep.type, referenceCount);
 				}
 			}
 
-			stream << "}\n";
+			endGraph(writer);
 		}
 	}
 }
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <list>
 #include <string>
+#include <unordered_map>
 #include <architect/Registry.hpp>
 #include <architect/Symbol.hpp>
 
@@ -61,6 +62,8 @@ namespace architect
 				return "composition";
 			case ReferenceType::ASSOCIATION:
 				return "association";
+			case ReferenceType::INCLUSION:
+				return "inclusion";
 			default:
 				return "???";
 			}
@@ -89,6 +92,11 @@ namespace architect
 				type = ReferenceType::ASSOCIATION;
 				return true;
 			}
+			if (str == "inclusion")
+			{
+				type = ReferenceType::INCLUSION;
+				return true;
+			}
 			return false;
 		}
 
@@ -106,6 +114,10 @@ namespace architect
 				return "recordTemplate";
 			case SymbolType::TYPEDEF:
 				return "typedef";
+			case SymbolType::EXTERNAL:
+				return "external";
+			case SymbolType::FILE:
+				return "file";
 			default:
 				return "???";
 			}
@@ -139,20 +151,30 @@ namespace architect
 				type = SymbolType::TYPEDEF;
 				return true;
 			}
+			if (str == "external")
+			{
+				type = SymbolType::EXTERNAL;
+				return true;
+			}
+			if (str == "file")
+			{
+				type = SymbolType::FILE;
+				return true;
+			}
 			return false;
 		}
 
 		_json getBasicSymbol(const Symbol *symbol)
 		{
 			_json jIdentifier = _json::object();
-			jIdentifier["name"] = symbol->identifier.name;
-			jIdentifier["type"] = symbol->identifier.type;
+			jIdentifier["name"] = symbol->getName();
+			jIdentifier["type"] = symbol->getTypeName();
 
 			std::list<std::string> namespaces;
 			Namespace *iterNs = symbol->ns;
 			while (iterNs->parent)
 			{
-				namespaces.push_front(iterNs->name);
+				namespaces.push_front(iterNs->getName());
 				iterNs = iterNs->parent;
 			}
 
@@ -169,6 +191,15 @@ namespace architect
 
 			return jSymbol;
 		}
+
+		_json dumpDiffEdge(const DiffEdge &edge)
+		{
+			_json jEdge = _json::object();
+			jEdge["from"] = getBasicSymbol(edge.from);
+			jEdge["to"] = getBasicSymbol(edge.to);
+			jEdge["type"] = dumpReferenceType(edge.type);
+			return jEdge;
+		}
 	}
 
 	namespace json
@@ -205,10 +236,14 @@ namespace architect
 				_json jIdentifier;
 				if (!getProperty(jSymbol, "identifier", jIdentifier) || !jIdentifier.is_object())
 					return false;
-				if (!getProperty(jIdentifier, "name", symbol->identifier.name))
+				_json::string_t jName;
+				if (!getProperty(jIdentifier, "name", jName))
 					return false;
-				if (!getProperty(jIdentifier, "type", symbol->identifier.type))
+				symbol->identifier.name = registry.strings.intern(jName);
+				_json::string_t jIdentifierType;
+				if (!getProperty(jIdentifier, "type", jIdentifierType))
 					return false;
+				symbol->identifier.type = registry.strings.intern(jIdentifierType);
 
 				_json jTemplateParameters;
 				if (getProperty(jSymbol, "templateParameters", jTemplateParameters))
@@ -235,22 +270,11 @@ namespace architect
 					{
 						if (!jNamespace.is_string())
 							return false;
-						std::string name = jNamespace.get<_json::string_t>();
-
-						auto it = iterNs->children.find(name);
-						if (it == iterNs->children.end())
-						{
-							Namespace *ns = registry.createNamespace();
-							ns->name = name;
-
-							ns->parent = iterNs;
-							it = iterNs->children.insert(std::pair<std::string, Namespace *>(name, ns)).first;
-						}
-
-						iterNs = it->second;
+						StringId name = registry.strings.intern(jNamespace.get<_json::string_t>());
+						iterNs = registry.getOrCreateNamespace(iterNs, name);
 					}
-					iterNs->symbols.insert(std::pair<SymbolIdentifier, Symbol *>(symbol->identifier, symbol));
 				}
+				iterNs->symbols.insert(std::pair<SymbolIdentifier, Symbol *>(symbol->identifier, symbol));
 				symbol->ns = iterNs;
 
 				_json jReferences;
@@ -336,10 +360,134 @@ namespace architect
 			stream << j.dump(parameters.pretty ? 2 : -1) << "\n";
 		}
 
+		void dumpDiff(const Diff &diff, nlohmann::json &j, const FormattingParameters &)
+		{
+			_json jAddedSymbols = _json::array();
+			for (auto symbol : diff.addedSymbols)
+				jAddedSymbols.push_back(getBasicSymbol(symbol));
+
+			_json jRemovedSymbols = _json::array();
+			for (auto symbol : diff.removedSymbols)
+				jRemovedSymbols.push_back(getBasicSymbol(symbol));
+
+			_json jAddedEdges = _json::array();
+			for (auto &edge : diff.addedEdges)
+				jAddedEdges.push_back(dumpDiffEdge(edge));
+
+			_json jRemovedEdges = _json::array();
+			for (auto &edge : diff.removedEdges)
+				jRemovedEdges.push_back(dumpDiffEdge(edge));
+
+			_json jChangedEdges = _json::array();
+			for (auto &edge : diff.changedEdges)
+			{
+				_json jEdge = _json::object();
+				jEdge["from"] = getBasicSymbol(edge.from);
+				jEdge["to"] = getBasicSymbol(edge.to);
+				jEdge["previousType"] = dumpReferenceType(edge.previousType);
+				jEdge["type"] = dumpReferenceType(edge.type);
+				jChangedEdges.push_back(jEdge);
+			}
+
+			j = _json::object();
+			j["addedSymbols"] = jAddedSymbols;
+			j["removedSymbols"] = jRemovedSymbols;
+			j["addedEdges"] = jAddedEdges;
+			j["removedEdges"] = jRemovedEdges;
+			j["changedEdges"] = jChangedEdges;
+		}
+
+		void dumpDiff(const Diff &diff, std::ostream &stream, const FormattingParameters &parameters)
+		{
+			_json j;
+			dumpDiff(diff, j, parameters);
+			stream << j.dump(parameters.pretty ? 2 : -1) << "\n";
+		}
+
+		void dumpHeaderCosts(const HeaderCosts &costs, nlohmann::json &j, const FormattingParameters &)
+		{
+			j = _json::array();
+			for (auto &cost : costs)
+			{
+				_json jCost = _json::object();
+				jCost["filename"] = cost.filename;
+				jCost["inclusionCount"] = cost.inclusionCount;
+				jCost["lineCount"] = cost.lineCount;
+				jCost["tokenCount"] = cost.tokenCount;
+				jCost["selfSeconds"] = cost.selfSeconds;
+				jCost["inclusiveSeconds"] = cost.inclusiveSeconds;
+				j.push_back(jCost);
+			}
+		}
+
+		void dumpHeaderCosts(const HeaderCosts &costs, std::ostream &stream, const FormattingParameters &parameters)
+		{
+			_json j;
+			dumpHeaderCosts(costs, j, parameters);
+			stream << j.dump(parameters.pretty ? 2 : -1) << "\n";
+		}
+
+		void dumpStats(const Stats &stats, nlohmann::json &j, const FormattingParameters &)
+		{
+			_json jPhases = _json::array();
+			for (auto &phase : stats.getPhases())
+			{
+				_json jPhase = _json::object();
+				jPhase["name"] = phase.name;
+				jPhase["seconds"] = std::chrono::duration<double>(phase.duration).count();
+				jPhase["count"] = phase.count;
+				jPhases.push_back(jPhase);
+			}
+
+			_json jCounters = _json::object();
+			for (auto &pair : stats.getCounters())
+				jCounters[pair.first] = pair.second;
+
+			// most memory first
+			_json jTranslationUnits = _json::array();
+			for (auto &translationUnit : stats.getTranslationUnits())
+			{
+				_json jMemory = _json::object();
+				for (auto &pair : translationUnit.memory)
+					jMemory[pair.first] = pair.second;
+
+				_json jTranslationUnit = _json::object();
+				jTranslationUnit["filename"] = translationUnit.filename;
+				jTranslationUnit["parseSeconds"] = std::chrono::duration<double>(translationUnit.parseDuration).count();
+				jTranslationUnit["visitSeconds"] = std::chrono::duration<double>(translationUnit.visitDuration).count();
+				jTranslationUnit["cursorCount"] = translationUnit.cursorCount;
+				jTranslationUnit["totalMemory"] = translationUnit.totalMemory;
+				jTranslationUnit["memory"] = jMemory;
+				jTranslationUnits.push_back(jTranslationUnit);
+			}
+
+			_json jMemory = _json::object();
+			for (auto &pair : stats.getTranslationUnitMemory())
+				jMemory[pair.first] = pair.second;
+
+			j = _json::object();
+			j["phases"] = jPhases;
+			j["counters"] = jCounters;
+			j["translationUnits"] = jTranslationUnits;
+			j["translationUnitMemory"] = jMemory;
+		}
+
+		void dumpStats(const Stats &stats, std::ostream &stream, const FormattingParameters &parameters)
+		{
+			_json j;
+			dumpStats(stats, j, parameters);
+			stream << j.dump(parameters.pretty ? 2 : -1) << "\n";
+		}
+
 		void dumpSymbols(const Symbols &symbols, nlohmann::json &j, const FormattingParameters &parameters)
 		{
 			_json::array_t jSymbols(symbols.size());
 
+			// parsing gives ids following the order of the symbols, which may be a subset of a registry
+			std::unordered_map<SymbolId, size_t> indices;
+			for (auto &pair : symbols)
+				indices.insert(std::make_pair(pair.first, indices.size()));
+
 			size_t index = 0;
 			for (auto &pair : symbols)
 			{
@@ -348,6 +496,10 @@ namespace architect
 				std::list<_json> references;
 				for (auto &pair : symbol->references)
 				{
+					auto it = indices.find(pair.first);
+					if (it == indices.end())
+						continue;
+
 					_json jReferenceSet = _json::array();
 					for (auto &reference : pair.second)
 					{
@@ -361,7 +513,7 @@ namespace architect
 					}
 
 					_json jReferences = _json::object();
-					jReferences["id"] = pair.first;
+					jReferences["id"] = it->second;
 					jReferences["references"] = jReferenceSet;
 
 					references.push_back(jReferences);
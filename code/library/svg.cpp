@@ -0,0 +1,637 @@
+#ifdef ARCHITECT_SVG_SUPPORT
+#include <architect/svg.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <architect/Registry.hpp>
+
+namespace architect
+{
+	namespace svg
+	{
+		namespace
+		{
+			const uint32_t noComponent = std::numeric_limits<uint32_t>::max();
+
+			const float characterWidth = 7.5f;
+			const float nodePadding = 16.f;
+			const float nodeHeight = 24.f;
+			const float nodeGap = 20.f;
+			const float dummyWidth = 4.f;
+			const float layerSpacing = 80.f;
+			const float margin = 20.f;
+
+			const size_t maxTitleNames = 50;
+
+			// symbol, or namespace collapsing several symbols
+			struct Node
+			{
+				std::string label;
+				const Symbol *symbol;
+				size_t symbolCount;
+			};
+
+			struct Graph
+			{
+				std::vector<Node> nodes;
+				std::vector<std::vector<std::pair<uint32_t, ReferenceType>>> edges;
+			};
+
+			// strongly connected component, or dummy vertex of an edge spanning several layers
+			struct Vertex
+			{
+				uint32_t component;
+				uint32_t layer;
+				float width;
+				std::vector<uint32_t> up;
+				std::vector<uint32_t> down;
+			};
+
+			struct LayoutEdge
+			{
+				std::vector<uint32_t> vertices; // from source to target, including dummies
+				ReferenceType type;
+			};
+
+			typedef std::vector<std::vector<uint32_t>> Layers;
+
+			struct Ordering
+			{
+				Layers layers;
+				std::vector<uint32_t> positions;
+				uint64_t crossings;
+			};
+
+			uint32_t getDepth(const Namespace *ns)
+			{
+				uint32_t depth = 0;
+				for (; ns->parent; ns = ns->parent)
+					++depth;
+				return depth;
+			}
+
+			void buildGraph(const Symbols &symbols, const FormattingParameters &parameters, Graph &graph)
+			{
+				std::unordered_map<SymbolId, uint32_t> symbolNodes;
+				std::unordered_map<const Namespace *, uint32_t> namespaceNodes;
+
+				for (auto &pair : symbols)
+				{
+					const Symbol *symbol = pair.second;
+
+					const Namespace *ns = symbol->ns;
+					if (parameters.collapseDepth >= 0)
+					{
+						uint32_t depth = getDepth(ns);
+						while (depth > (uint32_t)parameters.collapseDepth + 1)
+						{
+							ns = ns->parent;
+							--depth;
+						}
+
+						if (depth > (uint32_t)parameters.collapseDepth)
+						{
+							auto it = namespaceNodes.find(ns);
+							if (it != namespaceNodes.end())
+							{
+								++graph.nodes[it->second].symbolCount;
+								symbolNodes.insert(std::make_pair(pair.first, it->second));
+								continue;
+							}
+
+							uint32_t nodeIndex = (uint32_t)graph.nodes.size();
+							namespaceNodes.insert(std::make_pair(ns, nodeIndex));
+							symbolNodes.insert(std::make_pair(pair.first, nodeIndex));
+
+							Node node;
+							node.label = ns->qualifiedName;
+							node.symbol = nullptr;
+							node.symbolCount = 1;
+							graph.nodes.push_back(node);
+							continue;
+						}
+					}
+
+					symbolNodes.insert(std::make_pair(pair.first, (uint32_t)graph.nodes.size()));
+
+					Node node;
+					symbol->appendFullName(node.label);
+					node.symbol = symbol;
+					node.symbolCount = 1;
+					graph.nodes.push_back(node);
+				}
+
+				graph.edges.resize(graph.nodes.size());
+
+				// keeps the most important reference type of merged edges
+				std::unordered_map<uint64_t, size_t> edgeIndices;
+				for (auto &pair : symbols)
+				{
+					uint32_t from = symbolNodes.at(pair.first);
+					for (auto &refPair : pair.second->references)
+					{
+						auto it = symbolNodes.find(refPair.first);
+						if (it == symbolNodes.end() || it->second == from)
+							continue;
+
+						uint32_t to = it->second;
+						auto type = refPair.second.begin()->type;
+
+						uint64_t key = ((uint64_t)from << 32) | to;
+						auto itEdge = edgeIndices.find(key);
+						if (itEdge == edgeIndices.end())
+						{
+							edgeIndices.insert(std::make_pair(key, graph.edges[from].size()));
+							graph.edges[from].push_back(std::make_pair(to, type));
+						}
+						else
+						{
+							auto &edge = graph.edges[from][itEdge->second];
+							edge.second = std::min(edge.second, type);
+						}
+					}
+				}
+			}
+
+			// iterative Tarjan, components are numbered in reverse topological order
+			uint32_t computeComponents(const Graph &graph, std::vector<uint32_t> &components)
+			{
+				const uint32_t unvisited = std::numeric_limits<uint32_t>::max();
+				size_t nodeCount = graph.nodes.size();
+
+				std::vector<uint32_t> indices(nodeCount, unvisited);
+				std::vector<uint32_t> lowlinks(nodeCount);
+				std::vector<bool> onStack(nodeCount, false);
+				std::vector<uint32_t> stack;
+				std::vector<std::pair<uint32_t, size_t>> callStack;
+
+				components.assign(nodeCount, noComponent);
+				uint32_t index = 0;
+				uint32_t componentCount = 0;
+
+				for (uint32_t root = 0; root < nodeCount; ++root)
+				{
+					if (indices[root] != unvisited)
+						continue;
+
+					callStack.push_back(std::make_pair(root, 0));
+					while (!callStack.empty())
+					{
+						uint32_t node = callStack.back().first;
+						size_t &edgeIndex = callStack.back().second;
+
+						if (edgeIndex == 0 && indices[node] == unvisited)
+						{
+							indices[node] = index;
+							lowlinks[node] = index;
+							++index;
+							stack.push_back(node);
+							onStack[node] = true;
+						}
+
+						auto &edges = graph.edges[node];
+						if (edgeIndex < edges.size())
+						{
+							uint32_t child = edges[edgeIndex].first;
+							++edgeIndex;
+
+							if (indices[child] == unvisited)
+								callStack.push_back(std::make_pair(child, 0));
+							else if (onStack[child])
+								lowlinks[node] = std::min(lowlinks[node], indices[child]);
+							continue;
+						}
+
+						if (lowlinks[node] == indices[node])
+						{
+							uint32_t member;
+							do
+							{
+								member = stack.back();
+								stack.pop_back();
+								onStack[member] = false;
+								components[member] = componentCount;
+							} while (member != node);
+							++componentCount;
+						}
+
+						callStack.pop_back();
+						if (!callStack.empty())
+						{
+							uint32_t parent = callStack.back().first;
+							lowlinks[parent] = std::min(lowlinks[parent], lowlinks[node]);
+						}
+					}
+				}
+
+				return componentCount;
+			}
+
+			uint64_t countCrossings(const Layers &layers, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &positions)
+			{
+				uint64_t crossings = 0;
+				std::vector<uint32_t> targets;
+				std::vector<uint32_t> tree;
+
+				for (size_t layer = 0; layer + 1 < layers.size(); ++layer)
+				{
+					// edges sorted by source then target position, inversions of target positions are crossings
+					targets.clear();
+					for (auto vertex : layers[layer])
+					{
+						size_t begin = targets.size();
+						for (auto down : vertices[vertex].down)
+							targets.push_back(positions[down]);
+						std::sort(targets.begin() + begin, targets.end());
+					}
+
+					size_t size = layers[layer + 1].size();
+					tree.assign(size + 1, 0);
+					uint64_t inserted = 0;
+					for (auto target : targets)
+					{
+						uint64_t notGreater = 0;
+						for (size_t i = target + 1; i > 0; i -= i & (~i + 1))
+							notGreater += tree[i];
+						crossings += inserted - notGreater;
+
+						for (size_t i = target + 1; i <= size; i += i & (~i + 1))
+							++tree[i];
+						++inserted;
+					}
+				}
+
+				return crossings;
+			}
+
+			void sweep(Ordering &ordering, const std::vector<Vertex> &vertices, bool down)
+			{
+				std::vector<std::pair<float, uint32_t>> barycenters;
+
+				size_t layerCount = ordering.layers.size();
+				for (size_t i = 1; i < layerCount; ++i)
+				{
+					auto &layer = ordering.layers[down ? i : layerCount - 1 - i];
+
+					barycenters.clear();
+					for (auto vertex : layer)
+					{
+						auto &neighbors = down ? vertices[vertex].up : vertices[vertex].down;
+						float barycenter = (float)ordering.positions[vertex];
+						if (!neighbors.empty())
+						{
+							float sum = 0.f;
+							for (auto neighbor : neighbors)
+								sum += (float)ordering.positions[neighbor];
+							barycenter = sum / neighbors.size();
+						}
+						barycenters.push_back(std::make_pair(barycenter, vertex));
+					}
+
+					std::stable_sort(barycenters.begin(), barycenters.end(), [](const std::pair<float, uint32_t> &a, const std::pair<float, uint32_t> &b)
+					{
+						return a.first < b.first;
+					});
+
+					for (size_t position = 0; position < barycenters.size(); ++position)
+					{
+						layer[position] = barycenters[position].second;
+						ordering.positions[layer[position]] = (uint32_t)position;
+					}
+				}
+			}
+
+			// each thread starts from a different ordering, the best result is kept
+			void minimizeCrossings(Ordering &ordering, const std::vector<Vertex> &vertices, const FormattingParameters &parameters)
+			{
+				uint32_t threadCount = parameters.threadCount;
+				if (!threadCount)
+					threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+				std::vector<Ordering> results(threadCount, ordering);
+
+				auto run = [&](uint32_t threadIndex)
+				{
+					Ordering current = ordering;
+					if (threadIndex)
+					{
+						std::mt19937 random(threadIndex);
+						for (auto &layer : current.layers)
+						{
+							std::shuffle(layer.begin(), layer.end(), random);
+							for (size_t position = 0; position < layer.size(); ++position)
+								current.positions[layer[position]] = (uint32_t)position;
+						}
+					}
+
+					Ordering &best = results[threadIndex];
+					best = current;
+					best.crossings = countCrossings(current.layers, vertices, current.positions);
+
+					for (uint32_t i = 0; i < parameters.sweepCount && best.crossings; ++i)
+					{
+						sweep(current, vertices, i % 2 == 0);
+						current.crossings = countCrossings(current.layers, vertices, current.positions);
+						if (current.crossings < best.crossings)
+							best = current;
+					}
+				};
+
+				std::vector<std::thread> threads;
+				for (uint32_t threadIndex = 1; threadIndex < threadCount; ++threadIndex)
+					threads.push_back(std::thread(run, threadIndex));
+				run(0);
+				for (auto &thread : threads)
+					thread.join();
+
+				size_t bestIndex = 0;
+				for (size_t i = 1; i < results.size(); ++i)
+				{
+					if (results[i].crossings < results[bestIndex].crossings)
+						bestIndex = i;
+				}
+				ordering = std::move(results[bestIndex]);
+			}
+
+			void writeEscaped(std::ostream &stream, const std::string &str)
+			{
+				for (char c : str)
+				{
+					switch (c)
+					{
+					case '&':
+						stream << "&amp;";
+						break;
+					case '<':
+						stream << "&lt;";
+						break;
+					case '>':
+						stream << "&gt;";
+						break;
+					case '"':
+						stream << "&quot;";
+						break;
+					default:
+						stream << c;
+					}
+				}
+			}
+
+			const char *getReferenceClass(ReferenceType type)
+			{
+				switch (type)
+				{
+				case ReferenceType::TEMPLATE:
+					return "template";
+				case ReferenceType::INHERITANCE:
+					return "inheritance";
+				case ReferenceType::COMPOSITION:
+					return "composition";
+				case ReferenceType::ASSOCIATION:
+					return "association";
+				case ReferenceType::INCLUSION:
+					return "inclusion";
+				default:
+					return "";
+				}
+			}
+		}
+
+		FormattingParameters::FormattingParameters()
+			: collapseDepth(-1)
+			, threadCount(0)
+			, sweepCount(24)
+		{}
+
+		void dumpSymbols(const Symbols &symbols, std::ostream &stream, const FormattingParameters &parameters)
+		{
+			// https://en.wikipedia.org/wiki/Layered_graph_drawing
+
+			Graph graph;
+			buildGraph(symbols, parameters, graph);
+
+			std::vector<uint32_t> nodeComponents;
+			uint32_t componentCount = computeComponents(graph, nodeComponents);
+
+			std::vector<std::vector<uint32_t>> componentNodes(componentCount);
+			for (uint32_t node = 0; node < graph.nodes.size(); ++node)
+				componentNodes[nodeComponents[node]].push_back(node);
+
+			// condensation edges, merged by keeping the most important reference type
+			std::vector<std::unordered_map<uint32_t, ReferenceType>> componentEdges(componentCount);
+			for (uint32_t node = 0; node < graph.nodes.size(); ++node)
+			{
+				uint32_t from = nodeComponents[node];
+				for (auto &edge : graph.edges[node])
+				{
+					uint32_t to = nodeComponents[edge.first];
+					if (from == to)
+						continue;
+
+					auto result = componentEdges[from].insert(std::make_pair(to, edge.second));
+					if (!result.second)
+						result.first->second = std::min(result.first->second, edge.second);
+				}
+			}
+
+			// longest path layering, dependencies are below their dependents
+			std::vector<Vertex> vertices(componentCount);
+			for (uint32_t component = 0; component < componentCount; ++component)
+			{
+				auto &vertex = vertices[component];
+				vertex.component = component;
+				vertex.layer = 0;
+
+				size_t labelLength = graph.nodes[componentNodes[component].front()].label.size();
+				if (componentNodes[component].size() > 1)
+					labelLength += 16;
+				vertex.width = labelLength * characterWidth + nodePadding;
+			}
+
+			// reverse topological order of components is their numbering order
+			for (uint32_t component = componentCount; component-- > 0;)
+			{
+				for (auto &edge : componentEdges[component])
+					vertices[edge.first].layer = std::max(vertices[edge.first].layer, vertices[component].layer + 1);
+			}
+
+			std::vector<LayoutEdge> layoutEdges;
+			for (uint32_t component = 0; component < componentCount; ++component)
+			{
+				std::vector<std::pair<uint32_t, ReferenceType>> sortedEdges(componentEdges[component].begin(), componentEdges[component].end());
+				std::sort(sortedEdges.begin(), sortedEdges.end());
+
+				for (auto &edge : sortedEdges)
+				{
+					LayoutEdge layoutEdge;
+					layoutEdge.type = edge.second;
+					layoutEdge.vertices.push_back(component);
+
+					uint32_t previous = component;
+					for (uint32_t layer = vertices[component].layer + 1; layer < vertices[edge.first].layer; ++layer)
+					{
+						uint32_t dummy = (uint32_t)vertices.size();
+
+						Vertex vertex;
+						vertex.component = noComponent;
+						vertex.layer = layer;
+						vertex.width = dummyWidth;
+						vertices.push_back(vertex);
+
+						vertices[previous].down.push_back(dummy);
+						vertices[dummy].up.push_back(previous);
+						layoutEdge.vertices.push_back(dummy);
+						previous = dummy;
+					}
+
+					vertices[previous].down.push_back(edge.first);
+					vertices[edge.first].up.push_back(previous);
+					layoutEdge.vertices.push_back(edge.first);
+
+					layoutEdges.push_back(std::move(layoutEdge));
+				}
+			}
+
+			Ordering ordering;
+			ordering.positions.resize(vertices.size());
+			for (uint32_t vertex = 0; vertex < vertices.size(); ++vertex)
+			{
+				uint32_t layer = vertices[vertex].layer;
+				if (layer >= ordering.layers.size())
+					ordering.layers.resize(layer + 1);
+
+				ordering.positions[vertex] = (uint32_t)ordering.layers[layer].size();
+				ordering.layers[layer].push_back(vertex);
+			}
+
+			minimizeCrossings(ordering, vertices, parameters);
+
+			// coordinates of vertex centers, each layer is centered
+			std::vector<float> layerWidths(ordering.layers.size(), 0.f);
+			float width = 0.f;
+			for (size_t layer = 0; layer < ordering.layers.size(); ++layer)
+			{
+				for (auto vertex : ordering.layers[layer])
+					layerWidths[layer] += vertices[vertex].width + nodeGap;
+				width = std::max(width, layerWidths[layer]);
+			}
+
+			std::vector<float> xs(vertices.size());
+			for (size_t layer = 0; layer < ordering.layers.size(); ++layer)
+			{
+				float x = margin + (width - layerWidths[layer]) / 2.f;
+				for (auto vertex : ordering.layers[layer])
+				{
+					xs[vertex] = x + vertices[vertex].width / 2.f;
+					x += vertices[vertex].width + nodeGap;
+				}
+			}
+
+			auto getY = [&](uint32_t vertex)
+			{
+				return margin + nodeHeight / 2.f + vertices[vertex].layer * layerSpacing;
+			};
+
+			float height = margin * 2.f + nodeHeight + (ordering.layers.empty() ? 0.f : (ordering.layers.size() - 1) * layerSpacing);
+			width += margin * 2.f;
+
+			// large graphs have coordinates beyond the default 6 significant digits, the stream format is restored at the end
+			auto flags = stream.flags();
+			auto precision = stream.precision();
+			stream << std::fixed << std::setprecision(1);
+
+			stream << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height << "\" viewBox=\"0 0 " << width << " " << height << "\">\n"
+				<< "<defs><marker id=\"arrow\" viewBox=\"0 0 10 10\" refX=\"10\" refY=\"5\" markerWidth=\"8\" markerHeight=\"8\" orient=\"auto\"><path d=\"M0,0L10,5L0,10z\"/></marker></defs>\n"
+				<< "<style>"
+				<< ".edge{fill:none;stroke:#555;marker-end:url(#arrow)}"
+				<< ".edge.template{stroke:#c60;stroke-dasharray:4}"
+				<< ".edge.inheritance{stroke:#06c}"
+				<< ".edge.composition{stroke:#080}"
+				<< ".edge.inclusion{stroke-dasharray:2}"
+				<< ".node rect{fill:#fff;stroke:#000}"
+				<< ".node.undefined rect{stroke-dasharray:4}"
+				<< ".node.namespace rect{fill:#eef}"
+				<< ".node.cycle rect{fill:#fdd}"
+				<< "text{font:12px monospace;text-anchor:middle;dominant-baseline:central}"
+				<< "</style>\n";
+
+			for (auto &edge : layoutEdges)
+			{
+				stream << "<polyline class=\"edge " << getReferenceClass(edge.type) << "\" points=\"";
+
+				size_t count = edge.vertices.size();
+				for (size_t i = 0; i < count; ++i)
+				{
+					uint32_t vertex = edge.vertices[i];
+					float y = getY(vertex);
+					if (i == 0)
+						y += nodeHeight / 2.f;
+					else if (i == count - 1)
+						y -= nodeHeight / 2.f;
+
+					if (i)
+						stream << " ";
+					stream << xs[vertex] << "," << y;
+				}
+
+				stream << "\"/>\n";
+			}
+
+			for (uint32_t component = 0; component < componentCount; ++component)
+			{
+				auto &nodes = componentNodes[component];
+				const Node &first = graph.nodes[nodes.front()];
+
+				stream << "<g class=\"node";
+				if (nodes.size() > 1)
+					stream << " cycle";
+				else if (!first.symbol)
+					stream << " namespace";
+				else if (!first.symbol->defined)
+					stream << " undefined";
+				stream << "\">";
+
+				// full list of names on hover
+				stream << "<title>";
+				for (size_t i = 0; i < nodes.size() && i < maxTitleNames; ++i)
+				{
+					const Node &node = graph.nodes[nodes[i]];
+					if (i)
+						stream << "\n";
+					writeEscaped(stream, node.label);
+					if (!node.symbol)
+						stream << " (" << node.symbolCount << " symbols)";
+				}
+				if (nodes.size() > maxTitleNames)
+					stream << "\n...";
+				stream << "</title>";
+
+				auto &vertex = vertices[component];
+				float x = xs[component];
+				float y = getY(component);
+				stream << "<rect x=\"" << x - vertex.width / 2.f << "\" y=\"" << y - nodeHeight / 2.f << "\" width=\"" << vertex.width << "\" height=\"" << nodeHeight << "\"";
+				if (first.symbol && (first.symbol->type == SymbolType::GLOBAL || first.symbol->type == SymbolType::GLOBAL_TEMPLATE))
+					stream << " rx=\"" << nodeHeight / 2.f << "\"";
+				stream << "/>";
+
+				stream << "<text x=\"" << x << "\" y=\"" << y << "\">";
+				writeEscaped(stream, first.label);
+				if (nodes.size() > 1)
+					stream << " (+" << nodes.size() - 1 << " in cycle)";
+				stream << "</text></g>\n";
+			}
+
+			stream << "</svg>\n";
+
+			stream.flags(flags);
+			stream.precision(precision);
+		}
+	}
+}
+
+#endif
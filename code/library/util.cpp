@@ -1,5 +1,8 @@
 #include <architect/util.hpp>
 
+#include <cstdlib>
+#include <sys/stat.h>
+
 namespace architect
 {
 	namespace util
@@ -42,5 +45,50 @@ namespace architect
 			path = buffer;
 			return true;
 		}
+
+		bool lastWriteTime(const std::string &path, int64_t &time)
+		{
+#ifdef _WIN32
+			struct _stat64 status;
+			if (_stat64(path.c_str(), &status))
+				return false;
+#else
+			struct stat status;
+			if (stat(path.c_str(), &status))
+				return false;
+#endif
+
+			time = (int64_t)status.st_mtime;
+			return true;
+		}
+
+		bool temporaryDirectory(std::string &path)
+		{
+#ifdef _WIN32
+			char buffer[MAX_PATH + 1];
+			auto retval = GetTempPathA(MAX_PATH + 1, buffer);
+			if (!retval || retval > MAX_PATH)
+				return false;
+
+			// always ends with a backslash
+			path.assign(buffer, retval - 1);
+			return true;
+#else
+			const char *directory = getenv("TMPDIR");
+			path = directory && *directory ? directory : "/tmp";
+			if (path.size() > 1 && path.back() == '/')
+				path.pop_back();
+			return true;
+#endif
+		}
+
+		uint32_t processId()
+		{
+#ifdef _WIN32
+			return (uint32_t)GetCurrentProcessId();
+#else
+			return (uint32_t)getpid();
+#endif
+		}
 	}
 }
\ No newline at end of file
@@ -1,20 +1,156 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
 #include <fstream>
-#include <list>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
 #include <json.hpp>
 #include <tinydir.h>
 #include <architect.hpp>
+#include <cli.hpp>
 
 using json = nlohmann::json;
 
-const char *testArgv[2];
+typedef std::chrono::steady_clock Clock;
+
+enum class Status
+{
+	PENDING,
+	RUNNING,
+	SUCCEEDED,
+	FAILED,
+	TIMED_OUT,
+};
+
+struct TestResult
+{
+	std::string name;
+	std::string path;
+	Status status;
+	Clock::time_point start;
+	Clock::duration duration;
+};
+
+const char *programName;
+
+#ifdef ARCHITECT_CLANG_SUPPORT
+// shared by the workers, each running test gets its own index
+architect::clang::Session session;
+#endif
+
+bool endsWith(const std::string &text, const std::string &suffix)
+{
+	return text.size() >= suffix.size() && !text.compare(text.size() - suffix.size(), suffix.size(), suffix);
+}
+
+#ifdef ARCHITECT_JSON_SUPPORT
+// runs the operation on the registry given as JSON, and compares the result with the expected one
+bool testOperation(const json &jTest)
+{
+	auto itOperation = jTest.find("operation");
+	auto itRegistry = jTest.find("registry");
+	auto itExpected = jTest.find("expected");
+	if (itOperation == jTest.end() || !itOperation->is_string() || itRegistry == jTest.end() || itExpected == jTest.end())
+		return false;
+
+	architect::Registry registry;
+	if (!architect::json::parse(registry, *itRegistry))
+		return false;
+
+	auto operation = itOperation->get<std::string>();
+
+	// takes the expected number of seconds, to check that tests still run after one times out
+	if (operation == "sleep")
+	{
+		if (!itExpected->is_number())
+			return false;
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(itExpected->get<double>()));
+		return true;
+	}
+
+	if (operation == "removeRedundantDependencies")
+	{
+		architect::Registry expectedRegistry;
+		if (!architect::json::parse(expectedRegistry, *itExpected))
+			return false;
+
+		registry.removeRedundantDependencies();
+		return registry == expectedRegistry;
+	}
+
+	// the expected registry is equal, and must have the same fingerprint
+	if (operation == "fingerprint")
+	{
+		architect::Registry expectedRegistry;
+		if (!architect::json::parse(expectedRegistry, *itExpected))
+			return false;
+
+		return registry == expectedRegistry && registry.computeFingerprint() == expectedRegistry.computeFingerprint();
+	}
+
+	if (operation == "diff")
+	{
+		auto itPrevious = jTest.find("previous");
+		architect::Registry previousRegistry;
+		if (itPrevious == jTest.end() || !architect::json::parse(previousRegistry, *itPrevious))
+			return false;
+
+		json jDiff;
+		architect::json::dumpDiff(registry.computeDiff(previousRegistry), jDiff);
+		return jDiff == *itExpected;
+	}
+
+#ifdef ARCHITECT_DOT_SUPPORT
+	if (operation == "dot")
+	{
+		if (!itExpected->is_string())
+			return false;
+
+		std::ostringstream stream;
+		architect::dot::dumpSymbols(registry.getSymbols(), stream);
+		return stream.str() == itExpected->get<std::string>();
+	}
+#endif
+
+	return false;
+}
+#endif
 
 bool test(const char *testName)
 {
+	if (endsWith(testName, ".test.json"))
+	{
+#ifdef ARCHITECT_JSON_SUPPORT
+		std::ifstream file(testName);
+		if (!file.is_open())
+			return false;
+
+		json jTest;
+		try
+		{
+			file >> jTest;
+		}
+		catch (const std::exception &)
+		{
+			return false;
+		}
+		return testOperation(jTest);
+#else
+		return false;
+#endif
+	}
+
 #ifdef ARCHITECT_CLANG_SUPPORT
-	testArgv[1] = testName;
+	const char *testArgv[2] = { programName, testName };
 
 	architect::Registry actualRegistry;
-	if (!architect::clang::parse(actualRegistry, 2, testArgv))
+	if (!architect::clang::parse(actualRegistry, session, 2, testArgv))
 		return false;
 
 	std::string jsonFilename(testName);
@@ -36,52 +172,289 @@ bool test(const char *testName)
 
 	if (!architect::json::parse(expectedRegistry, ifile))
 		return false;
-	
+
 	return actualRegistry == expectedRegistry;
 #else
 	return false;
 #endif
 }
 
-int main(int argc, char **argv)
+const char *getStatusName(Status status)
+{
+	switch (status)
+	{
+	case Status::SUCCEEDED:
+		return "SUCCEEDED";
+	case Status::FAILED:
+		return "FAILED";
+	case Status::TIMED_OUT:
+		return "TIMED OUT";
+	default:
+		return "NOT RUN";
+	}
+}
+
+double getSeconds(Clock::duration duration)
 {
-	testArgv[0] = argv[0];
+	return std::chrono::duration<double>(duration).count();
+}
 
-	int errors = 0;
+std::string escapeXml(const std::string &text)
+{
+	std::string escaped;
+	for (char c : text)
+	{
+		switch (c)
+		{
+		case '&':
+			escaped += "&amp;";
+			break;
+		case '<':
+			escaped += "&lt;";
+			break;
+		case '>':
+			escaped += "&gt;";
+			break;
+		case '"':
+			escaped += "&quot;";
+			break;
+		default:
+			escaped += c;
+		}
+	}
+	return escaped;
+}
+
+void writeJUnit(const std::vector<TestResult> &results, Clock::duration duration, std::ostream &stream)
+{
+	size_t failureCount = std::count_if(results.begin(), results.end(), [](const TestResult &result)
+	{
+		return result.status != Status::SUCCEEDED;
+	});
+
+	stream << R"(<?xml version="1.0" encoding="UTF-8"?>)" << std::endl;
+	stream << R"(<testsuite name="architect" tests=")" << results.size() << R"(" failures=")" << failureCount << R"(" time=")" << getSeconds(duration) << R"(">)" << std::endl;
+	for (auto &result : results)
+	{
+		stream << R"(	<testcase classname="architect" name=")" << escapeXml(result.name) << R"(" time=")" << getSeconds(result.duration) << '"';
+		if (result.status == Status::SUCCEEDED)
+			stream << "/>" << std::endl;
+		else
+		{
+			stream << ">" << std::endl;
+			stream << R"(		<failure message=")" << getStatusName(result.status) << R"("/>)" << std::endl;
+			stream << "	</testcase>" << std::endl;
+		}
+	}
+	stream << "</testsuite>" << std::endl;
+}
+
+void writeJson(const std::vector<TestResult> &results, Clock::duration duration, std::ostream &stream)
+{
+	json jTests = json::array();
+	for (auto &result : results)
+	{
+		json jTest = json::object();
+		jTest["name"] = result.name;
+		jTest["status"] = getStatusName(result.status);
+		jTest["seconds"] = getSeconds(result.duration);
+		jTests.push_back(jTest);
+	}
+
+	json j = json::object();
+	j["tests"] = jTests;
+	j["seconds"] = getSeconds(duration);
+	stream << j.dump(2) << std::endl;
+}
+
+int main(int argc, const char **argv)
+{
+	programName = argv[0];
+
+	cli::Parser parser(argc, argv);
+
+	auto help = parser.defaultHelpFlag();
+
+	uint32_t threadCount = parser.option("threads")
+		.alias("t")
+		.defaultValue("0")
+		.description("Number of tests run concurrently, 0 for hardware concurrency")
+		.getValueAs<uint32_t>();
+
+	double timeout = parser.option("timeout")
+		.defaultValue("0")
+		.description("Seconds after which a test fails, 0 for no limit")
+		.getValueAs<double>();
+
+	auto junitFilename = parser.option("junit")
+		.description("Write a JUnit XML report to this file")
+		.getValue();
+
+	auto jsonFilename = parser.option("json")
+		.description("Write a JSON report to this file")
+		.getValue();
+
+	parser.help(help)
+		<< R"(architect.cpp tests
+Parses each .cpp file of the working directory and compares the symbols with the .cpp.json file next to it,
+and runs the operation described by each .test.json file on its registry
+Usage: [options])";
+
+	if (help.getValue() || parser.hasErrors())
+		return EXIT_FAILURE;
+
+	std::vector<TestResult> results;
 
 	tinydir_dir dir;
-	tinydir_open(&dir, ".");
+	tinydir_open_sorted(&dir, ".");
 
-	while (dir.has_next)
+	for (size_t i = 0; i < dir.n_files; ++i)
 	{
 		tinydir_file file;
-		tinydir_readfile(&dir, &file);
+		tinydir_readfile_n(&dir, &file, i);
 
 		if (!file.is_dir)
 		{
-			if (!strcmp(file.extension, "cpp"))
+			if (!strcmp(file.extension, "cpp") || endsWith(file.name, ".test.json"))
 			{
-				const char *testName = file.path;
-				bool succeeded = test(testName);
+				TestResult result;
+				result.name = file.name;
+				result.path = file.path;
+				result.status = Status::PENDING;
+				result.duration = Clock::duration::zero();
+				results.push_back(result);
+			}
+		}
+	}
+
+	tinydir_close(&dir);
+
+	if (!threadCount)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, (uint32_t)std::max<size_t>(results.size(), 1));
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	size_t nextTest = 0;
+	size_t finishedCount = 0;
 
-				std::cout << file.name << ": ";
+	auto start = Clock::now();
+
+	auto work = [&]
+	{
+		for (;;)
+		{
+			std::string path;
+			size_t index;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (nextTest == results.size())
+					return;
 
-				if (succeeded)
-					std::cout << "SUCCEEDED";
-				else
+				index = nextTest++;
+				results[index].status = Status::RUNNING;
+				results[index].start = Clock::now();
+				path = results[index].path;
+			}
+
+			bool succeeded = test(path.c_str());
+
+			std::lock_guard<std::mutex> lock(mutex);
+			auto &result = results[index];
+
+			// already reported if timed out
+			if (result.status != Status::RUNNING)
+				continue;
+
+			result.status = succeeded ? Status::SUCCEEDED : Status::FAILED;
+			result.duration = Clock::now() - result.start;
+			std::cout << result.name << ": " << getStatusName(result.status) << " (" << getSeconds(result.duration) << " s)" << std::endl;
+
+			++finishedCount;
+			condition.notify_one();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (uint32_t i = 0; i < threadCount; ++i)
+		workers.push_back(std::thread(work));
+
+	bool timedOut = false;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (finishedCount < results.size())
+		{
+			if (timeout <= 0.0)
+			{
+				condition.wait(lock);
+				continue;
+			}
+
+			auto limit = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout));
+			condition.wait_for(lock, std::chrono::milliseconds(100));
+
+			auto now = Clock::now();
+			for (auto &result : results)
+			{
+				if (result.status == Status::RUNNING && now - result.start > limit)
 				{
-					++errors;
-					std::cout << "FAILED";
-				}
+					result.status = Status::TIMED_OUT;
+					result.duration = now - result.start;
+					std::cout << result.name << ": " << getStatusName(result.status) << " (" << getSeconds(result.duration) << " s)" << std::endl;
+
+					++finishedCount;
+					timedOut = true;
 
-				std::cout << std::endl;
+					// the worker stays blocked in the test, another one takes over the pending tests
+					if (nextTest < results.size())
+						workers.push_back(std::thread(work));
+				}
 			}
 		}
+	}
+
+	auto duration = Clock::now() - start;
+
+	int errors = (int)std::count_if(results.begin(), results.end(), [](const TestResult &result)
+	{
+		return result.status != Status::SUCCEEDED;
+	});
+
+	std::cout << results.size() - errors << "/" << results.size() << " tests succeeded in " << getSeconds(duration) << " s" << std::endl;
+
+	if (junitFilename)
+	{
+		std::ofstream junitFile(junitFilename);
+		if (!junitFile.is_open())
+		{
+			std::cerr << "Cannot open file " << junitFilename << std::endl;
+			++errors;
+		}
+		else
+			writeJUnit(results, duration, junitFile);
+	}
 
-		tinydir_next(&dir);
+	if (jsonFilename)
+	{
+		std::ofstream jsonFile(jsonFilename);
+		if (!jsonFile.is_open())
+		{
+			std::cerr << "Cannot open file " << jsonFilename << std::endl;
+			++errors;
+		}
+		else
+			writeJson(results, duration, jsonFile);
 	}
 
-	tinydir_close(&dir);
+	// a timed out test cannot be interrupted, its worker is abandoned
+	if (timedOut)
+	{
+		std::cout.flush();
+		std::_Exit(errors);
+	}
+
+	for (auto &worker : workers)
+		worker.join();
 
 	return errors;
 }
@@ -7,9 +7,15 @@
 
 #pragma once
 
+#include <architect/Allocation.hpp>
+#include <architect/QueryIndex.hpp>
 #include <architect/Registry.hpp>
+#include <architect/RegistryStore.hpp>
+#include <architect/Stats.hpp>
+#include <architect/Trace.hpp>
 
 #include <architect/clang.hpp>
 #include <architect/console.hpp>
 #include <architect/dot.hpp>
 #include <architect/json.hpp>
+#include <architect/svg.hpp>
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace architect
+{
+	class Stats;
+
+	enum class AllocationCategory
+	{
+		NAMESPACE, // namespaces and their maps of children and symbols
+		SYMBOL, // symbols
+		REFERENCE, // maps and sets of references held by symbols
+		STRING_POOL, // nodes of the interned string maps
+		CLANG_STRING, // strings obtained from libclang while visiting
+		COUNT,
+	};
+
+	struct AllocationCounters
+	{
+		uint64_t count; // allocations made
+		uint64_t bytes; // bytes allocated, including freed ones
+		uint64_t liveBytes; // bytes currently allocated
+	};
+
+	// Counters are global and thread-safe. They are only fed when ARCHITECT_ALLOCATION_TRACKING is defined.
+	void recordAllocation(AllocationCategory category, size_t size);
+	void recordDeallocation(AllocationCategory category, size_t size);
+
+	AllocationCounters getAllocationCounters(AllocationCategory category);
+	const char *getAllocationCategoryName(AllocationCategory category);
+
+	// adds counters named e.g. "allocations.symbol.bytes"
+	void addAllocationCounters(Stats &stats);
+
+	// Standard allocator recording into a category.
+	template <typename T, AllocationCategory category>
+	class TrackingAllocator
+	{
+	public:
+		typedef T value_type;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef TrackingAllocator<U, category> other;
+		};
+
+		TrackingAllocator()
+		{}
+
+		template <typename U>
+		TrackingAllocator(const TrackingAllocator<U, category> &)
+		{}
+
+		T *allocate(size_t n)
+		{
+			T *pointer = std::allocator<T>().allocate(n);
+			recordAllocation(category, n * sizeof(T));
+			return pointer;
+		}
+
+		void deallocate(T *pointer, size_t n)
+		{
+			recordDeallocation(category, n * sizeof(T));
+			std::allocator<T>().deallocate(pointer, n);
+		}
+
+		template <typename U>
+		bool operator==(const TrackingAllocator<U, category> &) const
+		{
+			return true;
+		}
+
+		template <typename U>
+		bool operator!=(const TrackingAllocator<U, category> &) const
+		{
+			return false;
+		}
+	};
+
+	// allocator of the registry containers
+#ifdef ARCHITECT_ALLOCATION_TRACKING
+	template <typename T, AllocationCategory category>
+	using Allocator = TrackingAllocator<T, category>;
+#else
+	template <typename T, AllocationCategory category>
+	using Allocator = std::allocator<T>;
+#endif
+
+	// Class-specific allocation functions, for objects allocated one by one.
+	template <AllocationCategory category>
+	struct Tracked
+	{
+#ifdef ARCHITECT_ALLOCATION_TRACKING
+		static void *operator new(size_t size)
+		{
+			void *pointer = ::operator new(size);
+			recordAllocation(category, size);
+			return pointer;
+		}
+
+		static void operator delete(void *pointer, size_t size)
+		{
+			recordDeallocation(category, size);
+			::operator delete(pointer);
+		}
+#endif
+	};
+}
@@ -0,0 +1,55 @@
+#pragma once
+#ifdef ARCHITECT_CLANG_SUPPORT
+
+#include <cstring>
+#include <string>
+#include <clang-c/Index.h>
+#include <architect/Allocation.hpp>
+
+namespace architect
+{
+	// Owns a string returned by libclang, and disposes it when destroyed.
+	class ClangString
+	{
+	public:
+		explicit ClangString(CXString string)
+			: _string(string)
+			, _cString(clang_getCString(string))
+		{
+			if (!_cString)
+				_cString = "";
+
+#ifdef ARCHITECT_ALLOCATION_TRACKING
+			recordAllocation(AllocationCategory::CLANG_STRING, strlen(_cString) + 1);
+#endif
+		}
+
+		~ClangString()
+		{
+#ifdef ARCHITECT_ALLOCATION_TRACKING
+			recordDeallocation(AllocationCategory::CLANG_STRING, strlen(_cString) + 1);
+#endif
+
+			clang_disposeString(_string);
+		}
+
+		const char *c_str() const // never null
+		{
+			return _cString;
+		}
+
+		std::string str() const
+		{
+			return _cString;
+		}
+
+	private:
+		CXString _string;
+		const char *_cString;
+
+		ClangString(const ClangString &) = delete;
+		ClangString &operator=(const ClangString &) = delete;
+	};
+}
+
+#endif
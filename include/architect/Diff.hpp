@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <architect/Symbol.hpp>
+
+namespace architect
+{
+	// symbols are taken from the new registry when they exist in both
+	struct DiffEdge
+	{
+		const Symbol *from;
+		const Symbol *to;
+		ReferenceType type;
+	};
+
+	struct DiffChangedEdge
+	{
+		const Symbol *from;
+		const Symbol *to;
+		ReferenceType previousType;
+		ReferenceType type;
+	};
+
+	struct Diff
+	{
+		std::vector<const Symbol *> addedSymbols;
+		std::vector<const Symbol *> removedSymbols;
+
+		std::vector<DiffEdge> addedEdges;
+		std::vector<DiffEdge> removedEdges;
+		std::vector<DiffChangedEdge> changedEdges;
+
+		bool empty() const;
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace architect
+{
+	// 128-bit hash. Fingerprints are combined by addition, so that the result does not depend on the order.
+	struct Fingerprint
+	{
+		uint64_t high, low;
+
+		Fingerprint();
+
+		Fingerprint &operator+=(const Fingerprint &other);
+		Fingerprint &operator-=(const Fingerprint &other);
+
+		bool operator==(const Fingerprint &other) const;
+		bool operator!=(const Fingerprint &other) const;
+		bool operator<(const Fingerprint &other) const;
+
+		std::string toString() const; // 32 hexadecimal digits
+	};
+
+	class FingerprintBuilder
+	{
+	public:
+		FingerprintBuilder();
+
+		FingerprintBuilder &add(const std::string &value);
+		FingerprintBuilder &add(uint64_t value);
+		FingerprintBuilder &add(const Fingerprint &value);
+
+		Fingerprint get() const;
+
+	private:
+		void addByte(uint8_t byte);
+
+		uint64_t _high, _low;
+	};
+}
+
+namespace std
+{
+	template <>
+	struct hash<architect::Fingerprint>
+	{
+		size_t operator()(const architect::Fingerprint &fingerprint) const
+		{
+			return (size_t)(fingerprint.low ^ fingerprint.high);
+		}
+	};
+}
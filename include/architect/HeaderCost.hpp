@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace architect
+{
+	// Compile time estimated for a header over a set of translation units: the parse time of each translation unit is
+	// split between its files in proportion of their tokens.
+	struct HeaderCost
+	{
+		std::string filename; // absolute
+		uint32_t inclusionCount; // translation units including the header, directly or not
+		uint64_t lineCount;
+		uint64_t tokenCount;
+		double selfSeconds; // for the tokens of the header
+		double inclusiveSeconds; // also for the files that the header brought first into the translation units
+	};
+
+	// most inclusive time first, i.e. the headers whose removal or splitting would save the most
+	typedef std::vector<HeaderCost> HeaderCosts;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <architect/Registry.hpp>
+
+namespace architect
+{
+	// Structures derived from a registry to answer queries quickly. Once built, all methods are
+	// thread-safe. The registry must outlive the index and must not change.
+	class QueryIndex
+	{
+	public:
+		explicit QueryIndex(const Registry &registry);
+
+		const Registry &getRegistry() const;
+
+		Symbols findSymbols(const std::string &name) const;
+
+		// excluding the focus symbols
+		Symbols computeNeighborhood(const Symbols &focus, const ComputeNeighborhoodParameters &parameters = ComputeNeighborhoodParameters()) const;
+
+		// strongly connected component of the symbol, empty if the symbol is not in a cycle
+		const std::vector<const Symbol *> &getCycle(const Symbol *symbol) const;
+
+		// shortest chain of references from one symbol to another, empty if there is none
+		std::vector<const Symbol *> findPath(const Symbol *from, const Symbol *to) const;
+
+		// symbols referencing other symbols from the file, and all symbols depending on them
+		Symbols computeFileImpact(const std::string &filename) const;
+
+	private:
+		const Registry &_registry;
+		ReverseReferences _reverseReferences;
+		std::vector<std::vector<const Symbol *>> _cycles;
+		std::unordered_map<SymbolId, size_t> _symbolCycles;
+		std::unordered_map<std::string, std::vector<Symbol *>> _fileSymbols;
+	};
+}
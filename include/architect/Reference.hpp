@@ -11,6 +11,7 @@ namespace architect
 		INHERITANCE,
 		COMPOSITION,
 		ASSOCIATION,
+		INCLUSION, // of a file by another, in the include graph
 	};
 
 	struct Reference
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <set>
+#include <unordered_map>
+#include <vector>
 #include <json.hpp>
+#include <architect/Diff.hpp>
+#include <architect/Stats.hpp>
 #include <architect/Symbol.hpp>
 
 namespace architect
@@ -9,37 +16,124 @@ namespace architect
 	struct ComputeCyclesParameters
 	{
 		uint32_t minCardinality;
+		Stats *stats; // optional
 
 		ComputeCyclesParameters()
 			: minCardinality(0)
+			, stats(nullptr)
 		{}
 	};
 
+	enum class NeighborhoodDirection
+	{
+		IN, // symbols referencing the focus
+		OUT, // symbols referenced by the focus
+		BOTH,
+	};
+
+	struct ComputeNeighborhoodParameters
+	{
+		uint32_t radius; // maximum number of references from the focus
+		NeighborhoodDirection direction;
+
+		ComputeNeighborhoodParameters()
+			: radius(1)
+			, direction(NeighborhoodDirection::BOTH)
+		{}
+	};
+
+	// symbols referencing each symbol
+	typedef std::unordered_map<SymbolId, std::vector<Symbol *>> ReverseReferences;
+
+	// Creation and lookup methods are thread-safe, so that several visitors can fill the same registry.
+	// Other methods must not be called while the registry is being filled.
 	class Registry
 	{
 	public:
+		StringPool strings;
 		Namespace rootNameSpace;
 
 		Registry();
 		~Registry();
 
 		void clear();
+		void copy(const Registry &other); // deep copy, keeping symbol ids
 
-		Namespace *createNamespace();
+		Namespace *createNamespace(Namespace *parent, StringId name);
 		Symbol *createSymbol(SymbolType type, bool defined);
 
+		Namespace *findNamespace(const Namespace *parent, StringId name) const;
+		Namespace *getOrCreateNamespace(Namespace *parent, StringId name);
+
+		Symbol *findSymbol(const Namespace *ns, const SymbolIdentifier &identifier) const;
+		Symbol *getOrCreateSymbol(Namespace *ns, const SymbolIdentifier &identifier, SymbolType type, bool *created = nullptr);
+
+		// guards the maps of a namespace, or the fields of a symbol
+		std::mutex &getMutex(const void *object) const;
+
 		const Symbols &getSymbols() const;
 
+		// symbols whose qualified name (e.g. "A::B::f", without type nor template parameters) or full name matches
+		Symbols findSymbols(const std::string &name) const;
+
+		ReverseReferences computeReverseReferences() const;
+
+		// subset of the symbols within the radius of the focus symbols, which can be given to any dump function
+		// the reverse references are computed if needed and not given
+		Symbols computeNeighborhood(const Symbols &focus, const ComputeNeighborhoodParameters &parameters = ComputeNeighborhoodParameters(), const ReverseReferences *reverseReferences = nullptr) const;
+
 		void removeRedundantDependencies();
 		Cycles computeCycles(const ComputeCyclesParameters &parameters = ComputeCyclesParameters()) const;
 		Cycles computeScc(const ComputeCyclesParameters &parameters = ComputeCyclesParameters()) const;
 
+		// independent of symbol ids and creation order
+		Fingerprint computeFingerprint() const;
+		// contribution of a symbol to the registry fingerprint, to update it incrementally
+		Fingerprint computeFingerprint(const Symbol *symbol) const;
+
+		// changes from the previous registry to this one, symbols are matched by identity
+		Diff computeDiff(const Registry &previous) const;
+
+		// symbols are matched by identity, not by id
 		bool operator==(const Registry &other) const;
 
 	private:
+		static const size_t mutexCount = 64;
+
 		std::set<Namespace *> _namespaces;
 		Symbols _symbols;
 
-		SymbolId _nextSymbolId;
+		std::atomic<SymbolId> _nextSymbolId;
+
+		std::mutex _namespacesMutex;
+		std::mutex _symbolsMutex;
+		mutable std::array<std::mutex, mutexCount> _mutexes;
+
+		Registry(const Registry &) = delete;
+		Registry &operator=(const Registry &) = delete;
+	};
+
+	// Accumulates references on the calling thread, and inserts them into the symbols by batches.
+	class ReferenceBuffer
+	{
+	public:
+		ReferenceBuffer(Registry &registry, size_t capacity = 1024, Stats *stats = nullptr);
+		~ReferenceBuffer();
+
+		void insert(Symbol *symbol, SymbolId id, const Reference &reference);
+		void flush();
+
+	private:
+		struct PendingReference
+		{
+			Symbol *symbol;
+			SymbolId id;
+			Reference reference;
+		};
+
+		Registry &_registry;
+		std::vector<PendingReference> _references;
+		size_t _capacity;
+		Stats *_stats;
 	};
 }
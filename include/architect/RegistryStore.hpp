@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <architect/Registry.hpp>
+
+namespace architect
+{
+	// Publishes successive versions of a registry. Readers keep an immutable snapshot as long as they
+	// need it, while an update is applied to a copy of the latest version then published atomically,
+	// so that reading never waits for updating.
+	class RegistryStore
+	{
+	public:
+		typedef std::shared_ptr<const Registry> Snapshot;
+
+		RegistryStore();
+
+		Snapshot getSnapshot() const;
+
+		// applies the updater to a copy of the latest version, and publishes the copy if the updater returns true
+		// updates are serialized, and can only add: symbols and references are not owned by a translation unit,
+		// so parsing a modified file again keeps those removed from it, publish a registry parsed anew instead
+		bool update(const std::function<bool(Registry &)> &updater);
+
+		// replaces the latest version without copying it
+		void publish(std::unique_ptr<Registry> registry);
+
+	private:
+		Snapshot _snapshot;
+		std::mutex _updateMutex;
+
+		RegistryStore(const RegistryStore &) = delete;
+		RegistryStore &operator=(const RegistryStore &) = delete;
+	};
+}
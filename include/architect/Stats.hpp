@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <architect/Trace.hpp>
+
+namespace architect
+{
+	// Timings of phases and counters, filled by the library when given. Methods are thread-safe.
+	// Durations of a phase run by several threads are summed.
+	class Stats
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		struct Phase
+		{
+			std::string name;
+			Clock::duration duration;
+			uint64_t count;
+		};
+
+		typedef std::map<std::string, uint64_t> Counters;
+
+		// resources used by a translation unit
+		struct TranslationUnit
+		{
+			std::string filename;
+			Clock::duration parseDuration; // zero if parsed outside of the library
+			Clock::duration visitDuration;
+			uint64_t cursorCount;
+			Counters memory; // bytes per category, as reported by libclang
+			uint64_t totalMemory;
+		};
+
+		// called at the end of each phase, possibly from several threads
+		typedef std::function<void(const std::string &phase, Clock::duration duration)> Callback;
+
+		Stats();
+
+		void setCallback(const Callback &callback);
+
+		// also records each timed scope as a span, must be set before timing
+		void setTrace(Trace *trace);
+		Trace *getTrace() const;
+
+		void addPhase(const std::string &name, Clock::duration duration);
+		void addCounter(const std::string &name, uint64_t value);
+		void addCounters(const Counters &counters);
+		void addTranslationUnit(const TranslationUnit &translationUnit);
+
+		std::vector<Phase> getPhases() const; // in order of first occurrence
+		Counters getCounters() const;
+		std::vector<TranslationUnit> getTranslationUnits() const; // most memory first
+		Counters getTranslationUnitMemory() const; // bytes per category, summed over translation units
+
+	private:
+		mutable std::mutex _mutex;
+		Callback _callback;
+		Trace *_trace;
+		std::vector<Phase> _phases;
+		Counters _counters;
+		std::vector<TranslationUnit> _translationUnits;
+	};
+
+	// Adds the time until destruction to a phase, does nothing without stats.
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(Stats *stats, const char *phase); // phase must be a static string
+		~ScopedTimer();
+
+		void setDetail(const std::string &detail); // shown in the trace, e.g. the file being parsed
+
+		Stats::Clock::duration getElapsed() const;
+
+	private:
+		Stats *_stats;
+		const char *_phase;
+		std::string _detail;
+		Stats::Clock::time_point _start;
+
+		ScopedTimer(const ScopedTimer &) = delete;
+		ScopedTimer &operator=(const ScopedTimer &) = delete;
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <architect/Allocation.hpp>
+
+namespace architect
+{
+	typedef uint32_t StringId;
+
+	// Interns strings into 32-bit handles, which compare and hash in constant time.
+	// Interning and getting are thread-safe, clearing is not.
+	class StringPool
+	{
+	public:
+		static const StringId empty = 0; // id of the empty string
+
+		StringPool();
+
+		void clear();
+		void copy(const StringPool &other); // keeps the same ids, other must not be interning meanwhile
+
+		StringId intern(const std::string &value);
+		bool find(const std::string &value, StringId &id) const; // does not intern
+
+		const std::string &get(StringId id) const;
+
+	private:
+		// ids are interleaved between shards, so that concurrent interning rarely contends
+		static const uint32_t shardBits = 4;
+		static const uint32_t shardCount = 1 << shardBits;
+		// chunk sizes double, so that they are never reallocated and getting does not need to lock
+		static const uint32_t firstChunkBits = 8;
+		static const uint32_t chunkCount = 32 - shardBits - firstChunkBits + 1;
+
+		struct Shard
+		{
+			std::unordered_map<std::string, StringId, std::hash<std::string>, std::equal_to<std::string>,
+				Allocator<std::pair<const std::string, StringId>, AllocationCategory::STRING_POOL>> ids;
+			std::array<std::unique_ptr<const std::string *[]>, chunkCount> chunks;
+			uint32_t size;
+			mutable std::mutex mutex;
+		};
+
+		static void locate(uint32_t index, uint32_t &chunk, uint32_t &offset);
+
+		std::array<Shard, shardCount> _shards;
+	};
+}
@@ -4,34 +4,56 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include <architect/Allocation.hpp>
+#include <architect/Fingerprint.hpp>
 #include <architect/Reference.hpp>
+#include <architect/StringPool.hpp>
 
 namespace architect
 {
 	struct SymbolIdentifier
 	{
-		bool operator<(const SymbolIdentifier &other) const;
+		bool operator==(const SymbolIdentifier &other) const;
+		bool operator<(const SymbolIdentifier &other) const; // compares handles, not strings
 
-		std::string name;
-		std::string type;
+		StringId name;
+		StringId type;
+	};
+
+	struct SymbolIdentifierHash
+	{
+		size_t operator()(const SymbolIdentifier &identifier) const;
 	};
 
 	typedef unsigned int SymbolId;
 
 	struct Symbol;
 
-	struct Namespace
+	struct Namespace : Tracked<AllocationCategory::NAMESPACE>
 	{
+		typedef std::unordered_map<StringId, Namespace *, std::hash<StringId>, std::equal_to<StringId>,
+			Allocator<std::pair<const StringId, Namespace *>, AllocationCategory::NAMESPACE>> Children;
+		typedef std::unordered_map<SymbolIdentifier, Symbol *, SymbolIdentifierHash, std::equal_to<SymbolIdentifier>,
+			Allocator<std::pair<const SymbolIdentifier, Symbol *>, AllocationCategory::NAMESPACE>> SymbolsByIdentifier;
+
 		Namespace *parent;
-		std::map<std::string, Namespace *> children;
+		const StringPool *strings;
+		Children children;
 
-		std::map<SymbolIdentifier, Symbol *> symbols;
+		SymbolsByIdentifier symbols;
 
-		std::string name;
+		StringId name;
+		std::string qualifiedName; // "?" for anonymous namespaces, empty for the root namespace
+
+		const std::string &getName() const;
+		void computeQualifiedName(); // once parent and name are set
 	};
 
-	typedef std::map<SymbolId, std::set<Reference>> References;
+	typedef std::set<Reference, std::less<Reference>, Allocator<Reference, AllocationCategory::REFERENCE>> ReferenceSet;
+	typedef std::map<SymbolId, ReferenceSet, std::less<SymbolId>,
+		Allocator<std::pair<const SymbolId, ReferenceSet>, AllocationCategory::REFERENCE>> References;
 
 	enum class SymbolType
 	{
@@ -40,9 +62,11 @@ namespace architect
 		RECORD,
 		RECORD_TEMPLATE,
 		TYPEDEF,
+		EXTERNAL, // placeholder for a symbol declared in an external header, which was not visited
+		FILE, // source file or header of the include graph, named by its path
 	};
 
-	struct Symbol
+	struct Symbol : Tracked<AllocationCategory::SYMBOL>
 	{
 		Namespace *ns;
 		References references;
@@ -54,7 +78,14 @@ namespace architect
 		SymbolIdentifier identifier;
 		std::vector<std::string> templateParameters;
 
+		const std::string &getName() const;
+		const std::string &getTypeName() const; // spelling of the C++ type, not SymbolType
+
 		std::string getFullName() const;
+		void appendFullName(std::string &buffer) const; // does not allocate if buffer has enough capacity
+
+		// independent of the registry and of the id, for matching symbols across registries
+		Fingerprint computeIdentityFingerprint() const;
 	};
 
 	typedef std::map<SymbolId, Symbol *> Symbols;
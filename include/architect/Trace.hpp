@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace architect
+{
+	// Spans of time in the Chrome trace event format, viewable in chrome://tracing or Perfetto.
+	// Each thread appends to its own buffer without locking, only looking it up when switching traces.
+	// Writing must wait until the traced threads are done.
+	class Trace
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		Trace();
+
+		void addSpan(const char *name, const std::string &detail, Clock::time_point start, Clock::time_point end);
+
+		void write(std::ostream &stream) const;
+
+	private:
+		struct Span
+		{
+			const char *name; // static string
+			std::string detail;
+			int64_t start, duration; // microseconds
+		};
+
+		struct ThreadBuffer
+		{
+			std::thread::id threadId;
+			uint32_t threadIndex;
+			std::vector<Span> spans;
+		};
+
+		ThreadBuffer &getThreadBuffer();
+
+		uint64_t _generation; // distinguishes traces allocated at the same address
+		Clock::time_point _origin;
+		std::mutex _buffersMutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> _buffers;
+
+		Trace(const Trace &) = delete;
+		Trace &operator=(const Trace &) = delete;
+	};
+}
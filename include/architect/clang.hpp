@@ -1,14 +1,20 @@
 #pragma once
 #ifdef ARCHITECT_CLANG_SUPPORT
 
+#include <cstdint>
 #include <functional>
+#include <mutex>
 #include <string>
+#include <vector>
+#include <architect/HeaderCost.hpp>
 
+typedef void *CXIndex;
 typedef struct CXTranslationUnitImpl *CXTranslationUnit;
 
 namespace architect
 {
 	class Registry;
+	class Stats;
 
 	namespace clang
 	{
@@ -17,6 +23,10 @@ namespace architect
 		struct Parameters
 		{
 			Filter filter; // returns whether to visit symbols in the file
+			Stats *stats; // optional, receives parse and visit timings, and counts of cursors, symbols and references
+			bool pruneExternal; // skips declarations in system headers and external directories, symbols referenced there become placeholders
+			std::vector<std::string> externalDirectories; // include roots of third-party headers, besides system headers
+			bool includeGraph; // records files and their inclusions instead of symbols, function bodies are not parsed
 
 			Parameters();
 		};
@@ -33,9 +43,71 @@ namespace architect
 			std::string _path;
 		};
 
+		struct SessionParameters
+		{
+			bool excludeDeclarationsFromPCH;
+			bool displayDiagnostics;
+			std::string astCacheDirectory; // if not empty, parsed translation units are saved there, and loaded back instead of parsed while none of their files changed
+
+			SessionParameters();
+		};
+
+		// Pool of indices reused across parses, so that libclang is set up once. Thread-safe: each parse running
+		// concurrently gets its own index, so there are as many indices as parsing threads.
+		class Session
+		{
+		public:
+			explicit Session(const SessionParameters &parameters = SessionParameters());
+			~Session(); // translation units created from its indices must have been disposed
+
+			const SessionParameters &getParameters() const;
+
+			// for parsing outside of the library, the index must be released once its translation units are disposed
+			CXIndex acquireIndex(); // null on failure
+			void releaseIndex(CXIndex index);
+
+		private:
+			SessionParameters _parameters;
+			std::mutex _mutex;
+			std::vector<CXIndex> _indices;
+			std::vector<CXIndex> _freeIndices;
+
+			Session(const Session &) = delete;
+			Session &operator=(const Session &) = delete;
+		};
+
+		struct CompilationDatabaseParameters
+		{
+			uint32_t jobCount; // translation units parsed concurrently, 0 for hardware concurrency
+			bool sharedPCH; // precompiles the system includes common to all translation units, once, unless the session caches ASTs
+			std::string pchDirectory; // receives the precompiled header while parsing, temporary directory if empty
+
+			CompilationDatabaseParameters();
+		};
+
+		// parse functions can be called concurrently with the same registry, e.g. one thread per translation unit
 		void parse(Registry &registry, const CXTranslationUnit translationUnit, Parameters &parameters = Parameters());
 
+		bool parse(Registry &registry, Session &session, int argc, const char *const *argv, Parameters &parameters = Parameters());
+
+		// with a session used only for this call
 		bool parse(Registry &registry, int argc, const char *const *argv, Parameters &parameters = Parameters());
+
+		// loads a translation unit serialized by clang, e.g. with -emit-ast, without parsing it again
+		bool load(Registry &registry, Session &session, const std::string &astFilename, Parameters &parameters = Parameters());
+
+		// Parses the translation units of compile_commands.json in the build directory.
+		// With a shared PCH, the session should exclude declarations from PCH, so that they are visited only once.
+		// Returns false if any translation unit could not be parsed, the others are still parsed.
+		bool parseCompilationDatabase(Registry &registry, Session &session, const std::string &buildDirectory, const CompilationDatabaseParameters &databaseParameters = CompilationDatabaseParameters(), Parameters &parameters = Parameters());
+
+		// Parses each translation unit once, concurrently, and estimates the compile time spent on each header.
+		// Headers outside the filter, or external when pruning, are not reported, but still count in the inclusive time of
+		// the headers including them. The shared PCH and the AST cache are not used, so that parse times are real.
+		bool computeHeaderCosts(HeaderCosts &costs, Session &session, const std::string &buildDirectory, const CompilationDatabaseParameters &databaseParameters = CompilationDatabaseParameters(), Parameters &parameters = Parameters());
+
+		// of a single translation unit
+		bool computeHeaderCosts(HeaderCosts &costs, Session &session, int argc, const char *const *argv, Parameters &parameters = Parameters());
 	}
 }
 
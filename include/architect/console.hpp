@@ -2,6 +2,9 @@
 #ifdef ARCHITECT_CONSOLE_SUPPORT
 
 #include <ostream>
+#include <architect/Diff.hpp>
+#include <architect/HeaderCost.hpp>
+#include <architect/Stats.hpp>
 #include <architect/Symbol.hpp>
 
 namespace architect
@@ -12,6 +15,12 @@ namespace architect
 	{
 		void dumpCycles(const Cycles &cycles, std::ostream &stream);
 
+		void dumpDiff(const Diff &diff, std::ostream &stream);
+
+		void dumpHeaderCosts(const HeaderCosts &costs, std::ostream &stream);
+
+		void dumpStats(const Stats &stats, std::ostream &stream);
+
 		void dumpSymbols(const Symbols &symbols, std::ostream &stream);
 	}
 }
@@ -2,6 +2,7 @@
 #ifdef ARCHITECT_DOT_SUPPORT
 
 #include <ostream>
+#include <architect/Diff.hpp>
 #include <architect/Symbol.hpp>
 
 namespace architect
@@ -15,12 +16,17 @@ namespace architect
 		{
 			FormattingParameters();
 
+			bool clusterNamespaces; // whether to group symbols in nested clusters following their namespaces
+			int32_t collapseDepth; // symbols in deeper namespaces are collapsed into one node per namespace, negative to disable
 			bool displayReferenceCount; // whether to display the number of references on edges
 			bool pretty; // whether to format with indentations and line returns
+			bool stableIds; // whether node ids are derived from names rather than from symbol ids, so that they do not change between runs
 		};
 
 		void dumpCycles(const Cycles &cycles, std::ostream &stream, const FormattingParameters &parameters = FormattingParameters());
-		
+
+		void dumpDiff(const Diff &diff, std::ostream &stream, const FormattingParameters &parameters = FormattingParameters());
+
 		void dumpSymbols(const Symbols &symbols, std::ostream &stream, const FormattingParameters &parameters = FormattingParameters());
 	}
 }
@@ -4,6 +4,9 @@
 #include <istream>
 #include <ostream>
 #include <json.hpp>
+#include <architect/Diff.hpp>
+#include <architect/HeaderCost.hpp>
+#include <architect/Stats.hpp>
 #include <architect/Symbol.hpp>
 
 namespace architect
@@ -25,6 +28,15 @@ namespace architect
 		void dumpCycles(const Cycles &cycles, nlohmann::json &j, const FormattingParameters &parameters = FormattingParameters());
 		void dumpCycles(const Cycles &cycles, std::ostream &stream, const FormattingParameters &parameters = FormattingParameters());
 
+		void dumpDiff(const Diff &diff, nlohmann::json &j, const FormattingParameters &parameters = FormattingParameters());
+		void dumpDiff(const Diff &diff, std::ostream &stream, const FormattingParameters &parameters = FormattingParameters());
+
+		void dumpHeaderCosts(const HeaderCosts &costs, nlohmann::json &j, const FormattingParameters &parameters = FormattingParameters());
+		void dumpHeaderCosts(const HeaderCosts &costs, std::ostream &stream, const FormattingParameters &parameters = FormattingParameters());
+
+		void dumpStats(const Stats &stats, nlohmann::json &j, const FormattingParameters &parameters = FormattingParameters());
+		void dumpStats(const Stats &stats, std::ostream &stream, const FormattingParameters &parameters = FormattingParameters());
+
 		void dumpSymbols(const Symbols &symbols, nlohmann::json &j, const FormattingParameters &parameters = FormattingParameters());
 		void dumpSymbols(const Symbols &symbols, std::ostream &stream, const FormattingParameters &parameters = FormattingParameters());
 	}
@@ -0,0 +1,25 @@
+#pragma once
+#ifdef ARCHITECT_SVG_SUPPORT
+
+#include <ostream>
+#include <architect/Symbol.hpp>
+
+namespace architect
+{
+	namespace svg
+	{
+		struct FormattingParameters
+		{
+			FormattingParameters();
+
+			int32_t collapseDepth; // symbols in deeper namespaces are collapsed into one node per namespace, negative to disable
+			uint32_t threadCount; // for crossing minimization, 0 for hardware concurrency
+			uint32_t sweepCount; // number of crossing minimization passes per thread
+		};
+
+		// layered layout of the strongly connected components, which are drawn as single nodes
+		void dumpSymbols(const Symbols &symbols, std::ostream &stream, const FormattingParameters &parameters = FormattingParameters());
+	}
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include <unistd.h>
 #endif
 
+#include <cstdint>
 #include <string>
 
 namespace architect
@@ -16,5 +17,8 @@ namespace architect
 	{
 		bool absolutePath(std::string &path);
 		bool currentWorkingDirectory(std::string &path);
+		bool lastWriteTime(const std::string &path, int64_t &time); // seconds since epoch, false if the file does not exist
+		bool temporaryDirectory(std::string &path); // without trailing separator
+		uint32_t processId();
 	}
 }
@@ -13,6 +13,7 @@ formats = {
 	console = true,
 	dot = true,
 	json = true,
+	svg = true,
 }
 
 flags {
@@ -24,12 +25,14 @@ flags {
 
 defines {
 	-- "ARCHITECT_CLANG_PRINT_CURSORS", -- for debugging cursor traversal
+	-- "ARCHITECT_ALLOCATION_TRACKING", -- for counting allocations per category in statistics
 }
 
 if formats.clang then defines { "ARCHITECT_CLANG_SUPPORT" } end
 if formats.console then defines { "ARCHITECT_CONSOLE_SUPPORT" } end
 if formats.dot then defines { "ARCHITECT_DOT_SUPPORT" } end
 if formats.json then defines { "ARCHITECT_JSON_SUPPORT" } end
+if formats.svg then defines { "ARCHITECT_SVG_SUPPORT" } end
 
 filter "configurations:Debug"
 	defines {
@@ -118,6 +121,23 @@ project "tests-runner"
 	rtti "Off"
 	targetname "tests"
 
+project "bench"
+	files {
+		"code/bench/**",
+	}
+	includedirs {
+		"include",
+		"dep/include",
+	}
+	links {
+		"library",
+	}
+	if formats.clang then links { "libclang" } end
+	location "build"
+	kind "ConsoleApp"
+	rtti "Off"
+	targetname "bench"
+
 project "tests"
 	files {
 		"tests/**",